@@ -1,74 +1,245 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
-void extractBracketedText(const char *input, char *output)
+#define CHUNK_SIZE (1 << 20)
+
+/*
+ * Потоковый разбор: вход читается кусками по CHUNK_SIZE, состояние
+ * (внутри скобок или нет, внутри слова или нет) переживает границу куска,
+ * поэтому длина строки ничем не ограничена. Результат копится в одном
+ * буфере и сбрасывается в stdout по заполнении
+ */
+typedef struct Extractor {
+    int inBracket; // после '(' и до ')' или конца строки
+    int inWord; // предыдущий символ - часть слова в скобках
+    int wordCount; // слов в скобках на текущей строке
+    int lineHasText; // строка не пустая (пустые строки scanf(" %[^\n]") пропускал)
+    char *out;
+    size_t outLen;
+} Extractor;
+
+int initExtractor(Extractor *ex)
+{
+    memset(ex, 0, sizeof(Extractor));
+    ex->out = (char *)malloc(CHUNK_SIZE);
+    return ex->out ? 0 : -1;
+}
+
+void flushOutput(Extractor *ex)
+{
+    fwrite(ex->out, 1, ex->outLen, stdout);
+    ex->outLen = 0;
+}
+
+void putOutput(Extractor *ex, char ch)
+{
+    if (ex->outLen == CHUNK_SIZE)
+        flushOutput(ex);
+    ex->out[ex->outLen++] = ch;
+}
+
+void putOutputBytes(Extractor *ex, const char *src, size_t len)
+{
+    while (len > 0) {
+        if (ex->outLen == CHUNK_SIZE)
+            flushOutput(ex);
+        size_t part = CHUNK_SIZE - ex->outLen < len ? CHUNK_SIZE - ex->outLen : len;
+        memcpy(ex->out + ex->outLen, src, part);
+        ex->outLen += part;
+        src += part;
+        len -= part;
+    }
+}
+
+void endLine(Extractor *ex)
+{
+    if (ex->lineHasText)
+        putOutput(ex, '\n');
+    // незакрытая последней строкой '(' закрывается её концом
+    ex->inBracket = ex->inWord = ex->wordCount = ex->lineHasText = 0;
+}
+
+// посимвольный автомат - эталон для векторного варианта
+void extractBracketedTextScalar(Extractor *ex, const char *input, size_t len)
 {
-    const char *start = input;
-    int wordAdded = 0;
-
-    while (*start) {
-        start = strchr(start, '(');
-        if (start == NULL)
-            return;
-        start++; // сдвигаемся с '('
-        while (*start == ' ') // чтобы избежать пробела между '(' и словом
-            start++;
-
-        const char * end = strchr(start, ')');
-        if (end == NULL) 
-            end = start + strlen(start) / sizeof(char); // это работает
-        
-        if (start == end) continue; // tсли между '(' и ')' ничего нет, пропускаем этот фрагмент
-
-        while (start < end) {
-            if ((*start == ' ' && (*(start + 1) == ' ' || *(start + 1) == ')'))) // внутри скобок всегда из n пробелов остаётся один между слов
-                start++;
-            else {
-                *output++ = *start++;
-                wordAdded = 1;
+    for (const char *end = input + len; input < end; input++) {
+        char ch = *input;
+        if (ch == '\n') {
+            endLine(ex);
+        } else if (ch == ' ' || ch == '\t' || ch == '\r') {
+            ex->inWord = 0;
+        } else {
+            ex->lineHasText = 1;
+            if (ch == '(' || ch == ')') {
+                ex->inBracket = ch == '(';
+                ex->inWord = 0;
+            } else if (ex->inBracket) {
+                if (!ex->inWord && ex->wordCount++ > 0) // слова разделяются ровно одним пробелом
+                    putOutput(ex, ' ');
+                putOutput(ex, ch);
+                ex->inWord = 1;
             }
         }
-        if (wordAdded) {
-            *output++ = ' '; // добавляем пробел после последнего слова скобок
-            wordAdded = 0;
-        }
     }
-    output--; // сдвигаем указатель на последний добавленный пробел
-    if (*(output - 1) == ' ') // для случая, когда нет ')', но перед '\n' пробелы
-        output--; 
-    *output++ = '\0';
 }
 
-void stripString(char *str, int max_len)
+/*
+ * Векторный вариант: блок из 64 байт классифицируется в битовые маски
+ * '(', ')', '\n' и пробельных символов, а слова в скобках выделяются
+ * арифметикой над масками. Состояние между блоками - те же inBracket и inWord
+ */
+
+typedef struct BlockMasks {
+    uint64_t open, close, newline, space;
+} BlockMasks;
+
+typedef void (*classify_kernel) (const char *, BlockMasks *);
+
+void classifyScalar(const char *block, BlockMasks *m)
 {
-    int count = 0;
-    while(*str++ != '\0' && count++ < max_len) {
-        if(*str == '\n') {
-            *str = '\0';
-            break;
+    memset(m, 0, sizeof(BlockMasks));
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (block[i]) {
+        case '(': m->open |= bit; break;
+        case ')': m->close |= bit; break;
+        case '\n': m->newline |= bit; break;
+        case ' ': case '\t': case '\r': m->space |= bit; break;
         }
     }
 }
 
-int main(void)
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+uint64_t maskEqAvx2(__m256i lo, __m256i hi, char ch)
+{
+    __m256i c = _mm256_set1_epi8(ch);
+    uint32_t l = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, c));
+    uint32_t h = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, c));
+    return ((uint64_t)h << 32) | l;
+}
+
+__attribute__((target("avx2")))
+void classifyAvx2(const char *block, BlockMasks *m)
 {
-    char input[128];
+    __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+    m->open = maskEqAvx2(lo, hi, '(');
+    m->close = maskEqAvx2(lo, hi, ')');
+    m->newline = maskEqAvx2(lo, hi, '\n');
+    m->space = maskEqAvx2(lo, hi, ' ') | maskEqAvx2(lo, hi, '\t') | maskEqAvx2(lo, hi, '\r');
+}
 
-    while (scanf(" %[^\n]", input) != EOF) {
-        stripString(input, sizeof(input));
+classify_kernel selectClassifyKernel(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? classifyAvx2 : classifyScalar;
+}
 
-        char *output = (char *)calloc(128, sizeof(char));
-        if (!output) {
-            printf("Memory allocation error");
-            return 1;
-        }
+#else
+
+classify_kernel selectClassifyKernel(void)
+{
+    return classifyScalar;
+}
+
+#endif
+
+// выводит серии слов в скобках из keep, лежащие в [from, to)
+void emitRuns(Extractor *ex, const char *block, uint64_t keep, int from, int to)
+{
+    uint64_t range = (to == 64 ? ~(uint64_t)0 : ((uint64_t)1 << to) - 1) & ~(((uint64_t)1 << from) - 1);
+    keep &= range;
+    while (keep) {
+        int start = __builtin_ctzll(keep);
+        uint64_t rest = ~(keep >> start);
+        int len = rest ? __builtin_ctzll(rest) : 64 - start;
+        // серия с начала блока может продолжать слово из предыдущего
+        if (!(start == 0 && ex->inWord) && ex->wordCount++ > 0)
+            putOutput(ex, ' ');
+        putOutputBytes(ex, block + start, len);
+        ex->inWord = 0;
+        keep &= len + start == 64 ? 0 : ~(uint64_t)0 << (start + len);
+    }
+}
+
+void extractBlock(Extractor *ex, const char *block, const BlockMasks *m)
+{
+    uint64_t closing = m->close | m->newline; // конец строки тоже закрывает скобку
+    uint64_t neutral = ~(m->open | closing);
+    // перенос от '(' бежит через нейтральные позиции до закрывающей и гасит их:
+    // обнулившиеся нейтральные биты - ровно содержимое скобок
+    uint64_t base = neutral | m->open, sum;
+    int carry = __builtin_add_overflow(base, m->open, &sum);
+    carry |= __builtin_add_overflow(sum, (uint64_t)ex->inBracket, &sum);
+    uint64_t inside = base & ~sum & neutral;
+    uint64_t keep = inside & ~m->space;
+    uint64_t text = ~(m->space | m->newline);
 
-        extractBracketedText(input, output);
-        
-        printf("%s\n", output);
-        
-        free(output);
+    int pos = 0;
+    uint64_t newlines = m->newline;
+    while (newlines) {
+        int nl = __builtin_ctzll(newlines);
+        emitRuns(ex, block, keep, pos, nl);
+        if (text & ((((uint64_t)1 << nl) - 1) & ~(((uint64_t)1 << pos) - 1)))
+            ex->lineHasText = 1;
+        endLine(ex);
+        pos = nl + 1;
+        newlines &= newlines - 1;
     }
+    if (pos < 64) {
+        emitRuns(ex, block, keep, pos, 64);
+        if (text >> pos)
+            ex->lineHasText = 1;
+    }
+    ex->inBracket = carry;
+    ex->inWord = (int)(keep >> 63);
+}
+
+void extractBracketedText(Extractor *ex, const char *input, size_t len)
+{
+    classify_kernel classify = selectClassifyKernel();
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        BlockMasks m;
+        classify(input + i, &m);
+        extractBlock(ex, input + i, &m);
+    }
+    extractBracketedTextScalar(ex, input + i, len - i); // хвост короче блока
+}
+
+int main(void)
+{
+    Extractor ex;
+    char *input = (char *)malloc(CHUNK_SIZE);
+    if (!input || initExtractor(&ex) != 0) {
+        printf("Memory allocation error");
+        free(input);
+        return 1;
+    }
+
+    size_t got;
+    while ((got = fread(input, 1, CHUNK_SIZE, stdin)) > 0) {
+#ifdef SCALAR_EXTRACTOR
+        extractBracketedTextScalar(&ex, input, got);
+#else
+        extractBracketedText(&ex, input, got);
+#endif
+    }
+    endLine(&ex); // последняя строка могла быть без '\n'
+    flushOutput(&ex);
+
+    free(ex.out);
+    free(input);
     return 0;
 }
+
+/*
+ * gcc -O2 -o 05a_ 05a_.c - компиляция с векторным разбором
+ * gcc -O2 -DSCALAR_EXTRACTOR -o 05a_ 05a_.c - с эталонным посимвольным
+ */
@@ -1,151 +1,521 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
-#define WIDTH 80
+#define WIDTH 80 // ширина по умолчанию
+#define CHUNK_SIZE (1 << 20)
 
-typedef struct note {
-    char ch;
-    struct note * next;
-} note;
+/*
+ * Строка хранится одним непрерывным буфером, растущим удвоением, -
+ * добавление символа в конец амортизированно O(1). Слова описываются
+ * отрезками (начало, длина) в этом буфере, justify работает прямо по ним
+ */
+typedef struct textBuffer {
+    char *data;
+    size_t len, cap;
+} textBuffer;
 
-void append(note **head, char ch)
-{
-    note *newNote = (note *)malloc(sizeof(note));
-    if (newNote == NULL) {
-        printf("Malloc error");
-        return;
-    }
-    newNote->ch = ch;
-    newNote->next = NULL;
+typedef struct wordSpan {
+    size_t start;
+    int len;
+} wordSpan;
 
-    if (*head == NULL) {
-        *head = newNote;
-    } else { 
-        note *temp = *head;
-        while (temp->next) // ищем в цикле посследний элемент с next = NULL для записи в него
-            temp = temp->next;
-        temp->next = newNote;
+typedef struct wordIndex {
+    wordSpan *spans;
+    size_t count, cap;
+} wordIndex;
+
+int append(textBuffer *buf, char ch)
+{
+    if (buf->len == buf->cap) {
+        size_t cap = buf->cap ? buf->cap * 2 : 64;
+        char *data = (char *)realloc(buf->data, cap);
+        if (data == NULL) {
+            printf("Malloc error");
+            return -1;
+        }
+        buf->data = data;
+        buf->cap = cap;
     }
+    buf->data[buf->len++] = ch;
+    return 0;
 }
 
-note *stringToList(const char *str)
+int addWord(wordIndex *words, size_t start, int len)
 {
-    note *head = NULL;
-    while (*str) {
-        append(&head, *str++);
+    if (words->count == words->cap) {
+        size_t cap = words->cap ? words->cap * 2 : 16;
+        wordSpan *spans = (wordSpan *)realloc(words->spans, cap * sizeof(wordSpan));
+        if (spans == NULL) {
+            printf("Malloc error");
+            return -1;
+        }
+        words->spans = spans;
+        words->cap = cap;
     }
-    return head;
+    words->spans[words->count].start = start;
+    words->spans[words->count++].len = len;
+    return 0;
 }
 
-void removeExtraSpaces(note **head)
+// сжатие на месте: пробелы в начале удаляются, из группы разделителей остаётся первый;
+// попутно строится индекс слов
+void removeExtraSpaces(textBuffer *buf, wordIndex *words)
 {
-    note *current = *head, *prev = NULL;
+    size_t write = 0, wordStart = 0;
     int inWord = 0;
+    words->count = 0;
 
-    while (current) {
-        if (current->ch == ' ' || current->ch == '\t') {
-            if (!inWord) {
-                note *toDelete = current;
-                current = current->next;
-                if (prev)
-                    prev->next = current;
-                else // если удаляем пробелы из начала, где prev = NULL
-                    *head = current;
-                free(toDelete);
-            } else { // таким образом при встрече пробела ('\t'?) после слова мы оставляем только его
+    for (size_t read = 0; read < buf->len; read++) {
+        char ch = buf->data[read];
+        if (ch == ' ' || ch == '\t') {
+            if (inWord) { // таким образом при встрече пробела ('\t'?) после слова мы оставляем только его
+                addWord(words, wordStart, (int)(write - wordStart));
+                buf->data[write++] = ch;
                 inWord = 0;
-                prev = current;
-                current = current->next;
             }
         } else {
-            inWord = 1;
-            prev = current;
-            current = current->next;
+            if (!inWord) {
+                wordStart = write;
+                inWord = 1;
+            }
+            buf->data[write++] = ch;
         }
     }
+    if (inWord)
+        addWord(words, wordStart, (int)(write - wordStart));
+    buf->len = write;
 }
 
-void justify(note *head)
+/*
+ * Разбиение на строки. Жадное набирает в строку сколько влезет. Оптимальное
+ * (в духе Кнута-Пласса) минимизирует сумму квадратов недобора до ширины
+ * по всем строкам, кроме последней: f[j] = min f[i] + cost(i, j), где строка
+ * (i, j) - слова с i по j - 1. Разбиение задаётся массивом начал строк
+ */
+
+#define COST_INF (LLONG_MAX / 4)
+#define OPTIMAL_DP_WIDTH 256 // до такой ширины - прямой перебор окна, дальше - монотонная очередь
+
+typedef struct breakScratch {
+    long long *best; // f[j]
+    size_t *from; // начало последней строки в оптимуме для j
+    long long *prefix; // суммы длин слов
+    size_t *cand, *candFrom; // очередь кандидатов и первая позиция, где кандидат лучший
+    size_t *starts; // начала строк результата
+    size_t cap;
+} breakScratch;
+
+int reserveScratch(breakScratch *s, size_t wordCount)
 {
-    char words[WIDTH][WIDTH];
-    int wordLenghts[WIDTH];
-    int wordCount = 0, charCount = 0;
-    note *current = head;
+    if (wordCount + 1 <= s->cap)
+        return 0;
+    size_t cap = s->cap ? s->cap : 64;
+    while (cap < wordCount + 1)
+        cap *= 2;
+    long long *best = (long long *)realloc(s->best, cap * sizeof(long long));
+    if (best) s->best = best;
+    long long *prefix = (long long *)realloc(s->prefix, cap * sizeof(long long));
+    if (prefix) s->prefix = prefix;
+    size_t *from = (size_t *)realloc(s->from, cap * sizeof(size_t));
+    if (from) s->from = from;
+    size_t *cand = (size_t *)realloc(s->cand, cap * sizeof(size_t));
+    if (cand) s->cand = cand;
+    size_t *candFrom = (size_t *)realloc(s->candFrom, cap * sizeof(size_t));
+    if (candFrom) s->candFrom = candFrom;
+    size_t *starts = (size_t *)realloc(s->starts, cap * sizeof(size_t));
+    if (starts) s->starts = starts;
+    if (!best || !prefix || !from || !cand || !candFrom || !starts) {
+        printf("Malloc error");
+        return -1;
+    }
+    s->cap = cap;
+    return 0;
+}
 
-    while (current) {
-        if (current->ch != ' ' && current->ch != '\t') {
-            words[wordCount][charCount++] = current->ch;
-        } else if (charCount > 0) {
-            words[wordCount][charCount] = '\0';
-            wordLenghts[wordCount++] = charCount;
-            charCount = 0;
+size_t breakGreedy(const wordIndex *words, int width, size_t *starts)
+{
+    const wordSpan *spans = words->spans;
+    size_t lines = 0, i = 0;
+    while (i < words->count) {
+        int lineLength = spans[i].len;
+        size_t wordsInLine = 1;
+        while (i + wordsInLine < words->count && (lineLength + 1 + spans[i + wordsInLine].len <= width)) {
+            lineLength += 1 + spans[i + wordsInLine].len;
+            wordsInLine++;
         }
-        current = current->next;
+        starts[lines++] = i;
+        i += wordsInLine;
     }
-    if (charCount > 0) {
-        words[wordCount][charCount] = '\0';
-        wordLenghts[wordCount++] = charCount;
+    return lines;
+}
+
+// длина строки из слов [i, j) с одиночными пробелами
+long long lineLength(const breakScratch *s, size_t i, size_t j)
+{
+    return s->prefix[j] - s->prefix[i] + (long long)(j - i - 1);
+}
+
+long long lineCost(const breakScratch *s, int width, size_t i, size_t j)
+{
+    long long slack = width - lineLength(s, i, j);
+    if (slack < 0) // не влезает; одно слово длиннее ширины ставить всё равно некуда
+        return j - i == 1 ? 0 : COST_INF;
+    return slack * slack;
+}
+
+// прямой перебор: для каждого j - все i, пока строка (i, j) влезает; O(n * W)
+void optimalWindow(breakScratch *s, int width, size_t last)
+{
+    for (size_t j = 1; j <= last; j++) {
+        s->best[j] = COST_INF;
+        for (size_t i = j; i-- > 0; ) {
+            long long cost = lineCost(s, width, i, j);
+            if (cost >= COST_INF)
+                break;
+            if (s->best[i] + cost < s->best[j]) {
+                s->best[j] = s->best[i] + cost;
+                s->from[j] = i;
+            }
+        }
     }
+}
 
-    int i = 0;
-    while (i < wordCount) {
-        int lineLength = wordLenghts[i], wordsInLine = 1;
-        while (i + wordsInLine < wordCount && (lineLength + 1 + wordLenghts[i + wordsInLine] <= WIDTH)) {
-            lineLength += 1 + wordLenghts[i + wordsInLine];
-            wordsInLine++;
+/*
+ * Стоимость удовлетворяет четырёхугольному неравенству, поэтому оптимальное i
+ * не убывает с ростом j. Кандидаты держатся в очереди вместе с отрезками j,
+ * где каждый из них лучший; новый кандидат вытесняет хвост очереди, граница
+ * ищется бинарным поиском - O(n log n) независимо от ширины
+ */
+int laterWins(const breakScratch *s, int width, size_t later, size_t earlier, size_t j)
+{
+    long long laterCost = lineCost(s, width, later, j), earlierCost = lineCost(s, width, earlier, j);
+    if (earlierCost >= COST_INF) // раз строка от earlier уже не влезает, он не нужен ни здесь, ни дальше
+        return 1;
+    if (laterCost >= COST_INF)
+        return 0;
+    return s->best[later] + laterCost <= s->best[earlier] + earlierCost;
+}
+
+void optimalMonotone(breakScratch *s, int width, size_t last)
+{
+    size_t head = 0, tail = 0;
+    s->cand[tail] = 0;
+    s->candFrom[tail++] = 1;
+    for (size_t j = 1; j <= last; j++) {
+        while (head + 1 < tail && s->candFrom[head + 1] <= j)
+            head++;
+        s->best[j] = s->best[s->cand[head]] + lineCost(s, width, s->cand[head], j);
+        s->from[j] = s->cand[head];
+        if (j == last)
+            break;
+
+        // j как кандидат для позиций после j
+        while (tail > head) {
+            size_t pos = s->candFrom[tail - 1] > j + 1 ? s->candFrom[tail - 1] : j + 1;
+            if (!laterWins(s, width, j, s->cand[tail - 1], pos))
+                break;
+            tail--;
+        }
+        if (tail == head) {
+            s->cand[tail] = j;
+            s->candFrom[tail++] = j + 1;
+            continue;
         }
+        size_t lo = (s->candFrom[tail - 1] > j + 1 ? s->candFrom[tail - 1] : j + 1) + 1, hi = last + 1;
+        while (lo < hi) { // первая позиция, где j не хуже хвоста очереди
+            size_t mid = lo + (hi - lo) / 2;
+            if (laterWins(s, width, j, s->cand[tail - 1], mid))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        if (lo <= last) {
+            s->cand[tail] = j;
+            s->candFrom[tail++] = lo;
+        }
+    }
+}
 
-        int gaps = (wordsInLine > 1) ? wordsInLine - 1 : 1;
-        int spaces = WIDTH - (lineLength - gaps);
-        int baseSpaces = spaces / gaps;
-        int extraSpaces = spaces % gaps;
-
-        for (int j = 0; j < wordsInLine; j++) {
-            printf("%s", words[i + j]);
-            if (j < gaps) {
-                for (int s = 0; s < baseSpaces; s++)
-                    putchar(' ');
-                if (extraSpaces > 0) {
-                    putchar(' ');
-                    extraSpaces--;
-                }
-            }
+size_t breakOptimal(const wordIndex *words, int width, breakScratch *s)
+{
+    size_t n = words->count;
+    if (n == 0)
+        return 0;
+    s->prefix[0] = 0;
+    for (size_t i = 0; i < n; i++)
+        s->prefix[i + 1] = s->prefix[i] + words->spans[i].len;
+    s->best[0] = 0;
+
+    // все строки, кроме последней, - динамикой до n - 1
+    if (n > 1) {
+        if (width <= OPTIMAL_DP_WIDTH)
+            optimalWindow(s, width, n - 1);
+        else
+            optimalMonotone(s, width, n - 1);
+    }
+    // последняя строка бесплатна, если влезает
+    size_t lastStart = n - 1;
+    for (size_t i = n - 1; i-- > 0 && lineLength(s, i, n) <= width; )
+        if (s->best[i] <= s->best[lastStart])
+            lastStart = i;
+
+    size_t lines = 0;
+    for (size_t i = lastStart; ; i = s->from[i]) {
+        s->starts[lines++] = i;
+        if (i == 0)
+            break;
+    }
+    for (size_t a = 0, b = lines - 1; a < b; a++, b--) { // собирались с конца
+        size_t temp = s->starts[a];
+        s->starts[a] = s->starts[b];
+        s->starts[b] = temp;
+    }
+    return lines;
+}
+
+// строка вывода собирается целиком в line и уходит одним fwrite, отступы - через memset
+void emitLine(const textBuffer *buf, const wordSpan *spans, size_t wordsInLine, int width, textBuffer *line)
+{
+    int lineLength = spans[0].len;
+    for (size_t j = 1; j < wordsInLine; j++)
+        lineLength += 1 + spans[j].len;
+
+    // одно слово добивается пробелами справа до ширины
+    int gaps = (wordsInLine > 1) ? (int)wordsInLine - 1 : 1;
+    int spaces = width - (lineLength - ((int)wordsInLine - 1));
+    if (spaces < 0) // слово длиннее строки выводится как есть
+        spaces = 0;
+    int baseSpaces = spaces / gaps;
+    int extraSpaces = spaces % gaps;
+
+    line->len = 0;
+    size_t need = (size_t)lineLength - (wordsInLine - 1) + spaces + 1;
+    while (line->cap < need) // резерв под всю строку сразу
+        if (append(line, ' ') != 0)
+            return;
+    char *out = line->data;
+    for (size_t j = 0; j < wordsInLine; j++) {
+        memcpy(out, buf->data + spans[j].start, spans[j].len);
+        out += spans[j].len;
+        if ((int)j < gaps) {
+            int pad = baseSpaces + (extraSpaces > 0);
+            if (extraSpaces > 0)
+                extraSpaces--;
+            memset(out, ' ', pad);
+            out += pad;
         }
-        putchar('\n');
-        i += wordsInLine; 
     }
+    *out++ = '\n';
+    fwrite(line->data, 1, out - line->data, stdout);
 }
 
-void printList(note *head)
+void justify(const textBuffer *buf, const wordIndex *words, int width, int optimal,
+             breakScratch *scratch, textBuffer *line)
 {
-    while (head) {
-        printf("%c", head->ch);
-        head = head->next;
+    if (reserveScratch(scratch, words->count) != 0)
+        return;
+    size_t lines = optimal ? breakOptimal(words, width, scratch)
+                           : breakGreedy(words, width, scratch->starts);
+    for (size_t l = 0; l < lines; l++) {
+        size_t end = l + 1 < lines ? scratch->starts[l + 1] : words->count;
+        emitLine(buf, words->spans + scratch->starts[l], end - scratch->starts[l], width, line);
     }
+}
+
+void printBuffer(const textBuffer *buf)
+{
+    fwrite(buf->data, 1, buf->len, stdout);
     printf("\n");
 }
 
-void empty(note *head)
+void empty(textBuffer *buf, wordIndex *words, textBuffer *line, breakScratch *scratch)
+{
+    free(buf->data);
+    free(words->spans);
+    free(line->data);
+    free(scratch->best);
+    free(scratch->from);
+    free(scratch->prefix);
+    free(scratch->cand);
+    free(scratch->candFrom);
+    free(scratch->starts);
+}
+
+typedef struct justifier {
+    int width;
+    int paragraphs; // абзацы разделяются пустыми строками, строки внутри склеиваются
+    int optimal; // оптимальное разбиение вместо жадного
+    int lineHasText; // на текущей строке есть не только разделители
+    textBuffer text, line;
+    wordIndex words;
+    breakScratch scratch;
+} justifier;
+
+void flushParagraph(justifier *js)
+{
+    if (js->text.len == 0)
+        return;
+    removeExtraSpaces(&js->text, &js->words);
+    if (!js->paragraphs) // построчно сжатая строка выводится перед выровненной
+        printBuffer(&js->text);
+    justify(&js->text, &js->words, js->width, js->optimal, &js->scratch, &js->line);
+    js->text.len = 0;
+}
+
+void feed(justifier *js, const char *input, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        char ch = input[i];
+        if (ch == '\n') {
+            if (!js->paragraphs || !js->lineHasText)
+                flushParagraph(js);
+            else
+                append(&js->text, ' '); // перевод строки внутри абзаца - обычный разделитель
+            js->lineHasText = 0;
+        } else if (ch == ' ' || ch == '\t' || ch == '\r') {
+            if (js->lineHasText) // ведущие разделители строки ничего не значат
+                append(&js->text, ch == '\r' ? ' ' : ch);
+        } else {
+            js->lineHasText = 1;
+            append(&js->text, ch);
+        }
+    }
+}
+
+#ifdef BENCHMARK
+
+/*
+ * Сравнение разбиений: gcc -O2 -DBENCHMARK -o bench 05b_.c
+ * ./bench [words [width]] - абзац из words случайных слов (по умолчанию 10^6), ширина по умолчанию 80;
+ * для каждого способа - время и суммарная неровность (сумма квадратов недобора, без последней строки);
+ * строки dp - сама динамика каждым из двух способов, optimal - полный путь с выбором способа по ширине
+ */
+
+#include <time.h>
+
+double nowSec(void)
 {
-    while (head) {
-        note *toDelete = head;
-        head = head->next;
-        free(toDelete);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+long long raggedness(breakScratch *s, int width, const size_t *starts, size_t lines, size_t wordCount)
+{
+    long long total = 0;
+    for (size_t l = 0; l + 1 < lines; l++)
+        total += lineCost(s, width, starts[l], l + 1 < lines ? starts[l + 1] : wordCount);
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    size_t wordCount = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    int width = argc > 2 ? atoi(argv[2]) : WIDTH;
+
+    // длины слов как в обычном тексте: в основном короткие, изредка длинные
+    wordIndex words = {(wordSpan *)malloc(wordCount * sizeof(wordSpan)), wordCount, wordCount};
+    breakScratch scratch;
+    memset(&scratch, 0, sizeof(breakScratch));
+    if (!words.spans || reserveScratch(&scratch, wordCount) != 0) {
+        printf("Malloc error");
+        return 1;
+    }
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < wordCount; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int r = (seed >> 16) % 100;
+        words.spans[i].start = 0;
+        words.spans[i].len = r < 60 ? 1 + r % 5 : r < 95 ? 4 + r % 7 : 8 + r % 12;
     }
+    scratch.prefix[0] = 0;
+    for (size_t i = 0; i < wordCount; i++)
+        scratch.prefix[i + 1] = scratch.prefix[i] + words.spans[i].len;
+
+    printf("%zu words, width %d\n", wordCount, width);
+    printf("%-18s %10s %12s %16s\n", "method", "time", "lines", "raggedness");
+
+    double t = nowSec();
+    size_t lines = breakGreedy(&words, width, scratch.starts);
+    t = nowSec() - t;
+    printf("%-18s %9.4fs %12zu %16lld\n", "greedy", t, lines,
+           raggedness(&scratch, width, scratch.starts, lines, wordCount));
+
+    // обе динамики по отдельности; их f[n - 1] обязаны совпасть
+    const char *names[2] = {"dp(window)", "dp(monotone)"};
+    long long dpBest[2];
+    for (int method = 0; method < 2; method++) {
+        t = nowSec();
+        scratch.best[0] = 0;
+        if (method == 0)
+            optimalWindow(&scratch, width, wordCount - 1);
+        else
+            optimalMonotone(&scratch, width, wordCount - 1);
+        t = nowSec() - t;
+        dpBest[method] = scratch.best[wordCount - 1];
+        printf("%-18s %9.4fs %12s %16s\n", names[method], t, "-", "-");
+    }
+    if (dpBest[0] != dpBest[1])
+        printf("window and monotone DP disagree: %lld vs %lld\n", dpBest[0], dpBest[1]);
+
+    t = nowSec();
+    lines = breakOptimal(&words, width, &scratch);
+    t = nowSec() - t;
+    printf("%-18s %9.4fs %12zu %16lld\n", "optimal", t, lines,
+           raggedness(&scratch, width, scratch.starts, lines, wordCount));
+
+    free(words.spans);
+    free(scratch.best);
+    free(scratch.from);
+    free(scratch.prefix);
+    free(scratch.cand);
+    free(scratch.candFrom);
+    free(scratch.starts);
+    return 0;
 }
 
-int main()
+#else
+
+int main(int argc, char **argv)
 {
-    char buffer[512];
+    justifier js;
+    memset(&js, 0, sizeof(justifier));
+    js.width = WIDTH;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0)
+            js.paragraphs = 1;
+        else if (strcmp(argv[i], "-o") == 0)
+            js.optimal = 1;
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            js.width = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-w width] [-p] [-o]\n", argv[0]);
+            return 1;
+        }
+    }
 
-    while (scanf(" %[^\n]", buffer) != EOF) {
-        note *head = stringToList(buffer);
-        removeExtraSpaces(&head);
-        printList(head);
-        justify(head);
-        empty(head);
+    char *input = (char *)malloc(CHUNK_SIZE);
+    if (!input) {
+        printf("Malloc error");
+        return 1;
     }
+    size_t got;
+    while ((got = fread(input, 1, CHUNK_SIZE, stdin)) > 0)
+        feed(&js, input, got);
+    flushParagraph(&js); // последняя строка могла быть без '\n'
 
+    free(input);
+    empty(&js.text, &js.words, &js.line, &js.scratch);
     return 0;
 }
+
+#endif // BENCHMARK
+
+/*
+ * gcc -O2 -o 05b_ 05b_.c - компиляция
+ * ./05b_ [-w width] [-p] [-o] - запуск: ширина строки (по умолчанию 80),
+ *     -p - выравнивать абзацы целиком вместо отдельных строк,
+ *     -o - оптимальное разбиение на строки вместо жадного
+ */
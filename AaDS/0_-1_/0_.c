@@ -1,5 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 int digit_count(int num)
@@ -26,7 +36,146 @@ int prod_sum(int num)
     return even_sum * odd_sum;
 };
 
-void sort(int * array, size_t len, int (*crit1) (int), int (*crit2) (int))
+/*
+ * Пакетный подсчёт обоих критериев для массива. Знак на результат не влияет
+ * (у отрицательного числа все цифры отрицательны, чётность и произведение те же),
+ * поэтому векторные ядра работают с модулем как с беззнаковым числом
+ */
+
+typedef void (*criteria_kernel) (const int *, size_t, int *, int *);
+
+void criteria_scalar(const int *array, size_t len, int *digits, int *prods)
+{
+    for (size_t i = 0; i < len; i++) {
+        digits[i] = digit_count(array[i]);
+        prods[i] = prod_sum(array[i]);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// 10^k - 1 со сдвигом на знаковый бит: беззнаковое x >= 10^k через знаковое сравнение
+#define POW10_BIASED(p) ((int)(((uint32_t)(p) - 1u) ^ 0x80000000u))
+
+__attribute__((target("avx2")))
+void criteria_avx2(const int *array, size_t len, int *digits, int *prods)
+{
+    static const int pow10[9] = {10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    const __m256i bias = _mm256_set1_epi32((int)0x80000000u);
+    const __m256i magic = _mm256_set1_epi32((int)0xCCCCCCCDu); // x / 10 == (x * magic) >> 35
+    const __m256i ten = _mm256_set1_epi32(10);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i x = _mm256_abs_epi32(_mm256_loadu_si256((const __m256i *)(array + i)));
+
+        // количество цифр - число степеней десяти, не превосходящих x, плюс 1 для x != 0
+        __m256i xb = _mm256_xor_si256(x, bias);
+        __m256i count = _mm256_andnot_si256(_mm256_cmpeq_epi32(x, zero), one);
+        for (int k = 0; k < 9; k++)
+            count = _mm256_sub_epi32(count, _mm256_cmpgt_epi32(xb, _mm256_set1_epi32(POW10_BIASED(pow10[k]))));
+        _mm256_storeu_si256((__m256i *)(digits + i), count);
+
+        __m256i even = zero, odd = zero;
+        while (!_mm256_testz_si256(x, x)) {
+            // деление на 10 умножением: чётные и нечётные полосы по отдельности
+            __m256i qe = _mm256_srli_epi64(_mm256_mul_epu32(x, magic), 35);
+            __m256i qo = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), magic), 35);
+            __m256i q = _mm256_blend_epi32(qe, _mm256_slli_epi64(qo, 32), 0xAA);
+            __m256i digit = _mm256_sub_epi32(x, _mm256_mullo_epi32(q, ten));
+            __m256i isOdd = _mm256_cmpeq_epi32(_mm256_and_si256(digit, one), one);
+            odd = _mm256_add_epi32(odd, _mm256_and_si256(isOdd, digit));
+            even = _mm256_add_epi32(even, _mm256_andnot_si256(isOdd, digit));
+            x = q;
+        }
+        _mm256_storeu_si256((__m256i *)(prods + i), _mm256_mullo_epi32(even, odd));
+    }
+    criteria_scalar(array + i, len - i, digits + i, prods + i);
+}
+
+__attribute__((target("sse4.1")))
+void criteria_sse41(const int *array, size_t len, int *digits, int *prods)
+{
+    static const int pow10[9] = {10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+    const __m128i magic = _mm_set1_epi32((int)0xCCCCCCCDu);
+    const __m128i ten = _mm_set1_epi32(10);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i x = _mm_abs_epi32(_mm_loadu_si128((const __m128i *)(array + i)));
+
+        __m128i xb = _mm_xor_si128(x, bias);
+        __m128i count = _mm_andnot_si128(_mm_cmpeq_epi32(x, zero), one);
+        for (int k = 0; k < 9; k++)
+            count = _mm_sub_epi32(count, _mm_cmpgt_epi32(xb, _mm_set1_epi32(POW10_BIASED(pow10[k]))));
+        _mm_storeu_si128((__m128i *)(digits + i), count);
+
+        __m128i even = zero, odd = zero;
+        while (!_mm_testz_si128(x, x)) {
+            __m128i qe = _mm_srli_epi64(_mm_mul_epu32(x, magic), 35);
+            __m128i qo = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), magic), 35);
+            __m128i q = _mm_blend_epi16(qe, _mm_slli_epi64(qo, 32), 0xCC);
+            __m128i digit = _mm_sub_epi32(x, _mm_mullo_epi32(q, ten));
+            __m128i isOdd = _mm_cmpeq_epi32(_mm_and_si128(digit, one), one);
+            odd = _mm_add_epi32(odd, _mm_and_si128(isOdd, digit));
+            even = _mm_add_epi32(even, _mm_andnot_si128(isOdd, digit));
+            x = q;
+        }
+        _mm_storeu_si128((__m128i *)(prods + i), _mm_mullo_epi32(even, odd));
+    }
+    criteria_scalar(array + i, len - i, digits + i, prods + i);
+}
+
+#undef POW10_BIASED
+
+criteria_kernel select_criteria_kernel(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return criteria_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return criteria_sse41;
+    return criteria_scalar;
+}
+
+#else
+
+criteria_kernel select_criteria_kernel(void)
+{
+    return criteria_scalar;
+}
+
+#endif
+
+void eval_criteria(const int *array, size_t len, int *digits, int *prods)
+{
+    select_criteria_kernel()(array, len, digits, prods);
+}
+
+#define CRITERIA_BLOCK 256
+
+// критерии для блока до CRITERIA_BLOCK элементов: штатные - пакетно, прочие - поэлементно
+void criteria_block(const int *array, size_t len, int (*crit1) (int), int (*crit2) (int),
+                    criteria_kernel kernel, int *c1, int *c2)
+{
+    if (crit1 == digit_count && crit2 == prod_sum) {
+        kernel(array, len, c1, c2);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        c1[i] = crit1(array[i]);
+        c2[i] = crit2(array[i]);
+    }
+}
+
+void selection_sort(int * array, size_t len, int (*crit1) (int), int (*crit2) (int))
 {
     for(int i = 0; i < len - 1; i++){
         int left = i;
@@ -49,32 +198,935 @@ void sort(int * array, size_t len, int (*crit1) (int), int (*crit2) (int))
     }
 };
 
-int main(void)
+/*
+ * Кэширующий движок сортировки: критерии считаются один раз на элемент
+ * и упаковываются в 64-битный ключ, дальше сравниваются только ключи
+ */
+
+#define INSERTION_THRESHOLD 16
+#define RADIX_THRESHOLD 4096
+
+typedef struct sort_key {
+    uint64_t key; // старшие 32 бита - crit1 (по возрастанию), младшие - crit2 (по убыванию)
+    uint32_t pos; // исходная позиция, равные ключи сохраняют порядок ввода
+    int value;
+} sort_key;
+
+uint64_t pack_key(int c1, int c2)
+{
+    // xor со знаковым битом переводит порядок int в порядок uint32, ~ разворачивает его
+    uint32_t hi = (uint32_t)c1 ^ 0x80000000u;
+    uint32_t lo = ~((uint32_t)c2 ^ 0x80000000u);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+sort_key *build_keys(const int *array, size_t len, int (*crit1) (int), int (*crit2) (int))
+{
+    sort_key *keys = (sort_key *)malloc(len * sizeof(sort_key));
+    if (!keys)
+        return NULL;
+    criteria_kernel kernel = select_criteria_kernel();
+    int c1[CRITERIA_BLOCK], c2[CRITERIA_BLOCK];
+    for (size_t from = 0; from < len; from += CRITERIA_BLOCK) {
+        size_t n = len - from < CRITERIA_BLOCK ? len - from : CRITERIA_BLOCK;
+        criteria_block(array + from, n, crit1, crit2, kernel, c1, c2);
+        for (size_t i = 0; i < n; i++) {
+            keys[from + i].key = pack_key(c1[i], c2[i]);
+            keys[from + i].pos = (uint32_t)(from + i);
+            keys[from + i].value = array[from + i];
+        }
+    }
+    return keys;
+}
+
+int key_less(const sort_key *a, const sort_key *b)
+{
+    return a->key < b->key || (a->key == b->key && a->pos < b->pos);
+}
+
+void swap_keys(sort_key *a, sort_key *b)
+{
+    sort_key temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+void insertion_sort_keys(sort_key *keys, size_t len)
+{
+    for (size_t i = 1; i < len; i++) {
+        sort_key cur = keys[i];
+        size_t j = i;
+        while (j > 0 && key_less(&cur, &keys[j - 1])) {
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = cur;
+    }
+}
+
+void sift_down_keys(sort_key *keys, size_t root, size_t len)
+{
+    while (2 * root + 1 < len) {
+        size_t child = 2 * root + 1;
+        if (child + 1 < len && key_less(&keys[child], &keys[child + 1]))
+            child++;
+        if (!key_less(&keys[root], &keys[child]))
+            return;
+        swap_keys(&keys[root], &keys[child]);
+        root = child;
+    }
+}
+
+void heap_sort_keys(sort_key *keys, size_t len)
+{
+    for (size_t i = len / 2; i-- > 0; )
+        sift_down_keys(keys, i, len);
+    for (size_t end = len - 1; end > 0; end--) {
+        swap_keys(&keys[0], &keys[end]);
+        sift_down_keys(keys, 0, end);
+    }
+}
+
+void introsort_loop(sort_key *keys, size_t len, int depth)
+{
+    while (len > INSERTION_THRESHOLD) {
+        if (depth-- == 0) { // рекурсия выродилась - доделываем кучей, O(n log n) гарантирован
+            heap_sort_keys(keys, len);
+            return;
+        }
+        // медиана трёх уходит в keys[0] и служит опорным
+        size_t mid = len / 2;
+        if (key_less(&keys[mid], &keys[0]))
+            swap_keys(&keys[mid], &keys[0]);
+        if (key_less(&keys[len - 1], &keys[0]))
+            swap_keys(&keys[len - 1], &keys[0]);
+        if (key_less(&keys[len - 1], &keys[mid]))
+            swap_keys(&keys[len - 1], &keys[mid]);
+        swap_keys(&keys[0], &keys[mid]);
+
+        size_t i = 0, j = len;
+        for (;;) { // разбиение Хоара, ключи попарно различны благодаря pos
+            while (key_less(&keys[++i], &keys[0]));
+            while (key_less(&keys[0], &keys[--j]));
+            if (i >= j)
+                break;
+            swap_keys(&keys[i], &keys[j]);
+        }
+        swap_keys(&keys[0], &keys[j]);
+
+        // в рекурсию уходит меньшая часть, большая обрабатывается циклом
+        if (j < len - j - 1) {
+            introsort_loop(keys, j, depth);
+            keys += j + 1;
+            len -= j + 1;
+        } else {
+            introsort_loop(keys + j + 1, len - j - 1, depth);
+            len = j;
+        }
+    }
+    insertion_sort_keys(keys, len);
+}
+
+void introsort_keys(sort_key *keys, size_t len)
+{
+    int depth = 0;
+    for (size_t n = len; n > 1; n >>= 1)
+        depth += 2;
+    introsort_loop(keys, len, depth);
+}
+
+int radix_sort_keys(sort_key *keys, size_t len)
+{
+    // LSD по байтам ключа; гистограммы всех 8 байт собираются за один проход
+    size_t counts[8][256] = {{0}};
+    for (size_t i = 0; i < len; i++)
+        for (int b = 0; b < 8; b++)
+            counts[b][(keys[i].key >> (8 * b)) & 0xFF]++;
+
+    sort_key *scratch = (sort_key *)malloc(len * sizeof(sort_key));
+    if (!scratch)
+        return -1;
+
+    sort_key *src = keys, *dst = scratch;
+    for (int b = 0; b < 8; b++) {
+        size_t *count = counts[b];
+        if (count[(src[0].key >> (8 * b)) & 0xFF] == len) // байт одинаков у всех - проход не нужен
+            continue;
+        size_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < len; i++)
+            dst[count[(src[i].key >> (8 * b)) & 0xFF]++] = src[i];
+        sort_key *temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != keys)
+        memcpy(keys, src, len * sizeof(sort_key));
+    free(scratch);
+    return 0;
+}
+
+void key_sort(int * array, size_t len, int (*crit1) (int), int (*crit2) (int))
+{
+    if (len < 2)
+        return;
+    sort_key *keys = build_keys(array, len, crit1, crit2);
+    if (!keys) { // не хватило памяти под ключи - остаёмся на месте
+        selection_sort(array, len, crit1, crit2);
+        return;
+    }
+    // малые массивы быстрее сравнениями, большие - поразрядно
+    if (len < RADIX_THRESHOLD || radix_sort_keys(keys, len) != 0)
+        introsort_keys(keys, len);
+    for (size_t i = 0; i < len; i++)
+        array[i] = keys[i].value;
+    free(keys);
+};
+
+/*
+ * Сортировка подсчётом для критериев с малым диапазоном значений:
+ * пара (crit1, crit2) сворачивается в номер корзины, порядок задаётся корзинами
+ */
+
+#define RADIX_MAX_BUCKETS (1 << 16)
+
+typedef struct crit_range {
+    int min, max; // границы значений критерия включительно
+} crit_range;
+
+// digit_count от int - не более 10 цифр, prod_sum - не больше 45 * 45 (суммы по модулю до 90)
+static const crit_range DIGIT_COUNT_RANGE = {0, 10};
+static const crit_range PROD_SUM_RANGE = {0, 2025};
+
+typedef struct crit_pair {
+    int c1, c2;
+    int value;
+} crit_pair;
+
+// критерии всех элементов в pairs, заодно их фактические диапазоны
+void eval_pairs(const int *array, size_t len, int (*crit1) (int), int (*crit2) (int),
+                crit_pair *pairs, crit_range *range1, crit_range *range2)
 {
-    int n = 0;
-    puts("\nEnter the number of numbers:");
-    if (scanf("%d%c", &n) != 1 || n <= 0) 
+    criteria_kernel kernel = select_criteria_kernel();
+    crit_range r1 = {INT_MAX, INT_MIN}, r2 = {INT_MAX, INT_MIN};
+    int c1[CRITERIA_BLOCK], c2[CRITERIA_BLOCK];
+    for (size_t from = 0; from < len; from += CRITERIA_BLOCK) {
+        size_t n = len - from < CRITERIA_BLOCK ? len - from : CRITERIA_BLOCK;
+        criteria_block(array + from, n, crit1, crit2, kernel, c1, c2);
+        for (size_t i = 0; i < n; i++) {
+            pairs[from + i].c1 = c1[i];
+            pairs[from + i].c2 = c2[i];
+            pairs[from + i].value = array[from + i];
+            if (c1[i] < r1.min) r1.min = c1[i];
+            if (c1[i] > r1.max) r1.max = c1[i];
+            if (c2[i] < r2.min) r2.min = c2[i];
+            if (c2[i] > r2.max) r2.max = c2[i];
+        }
+    }
+    *range1 = r1;
+    *range2 = r2;
+}
+
+int radix_sort(int * array, size_t len, int (*crit1) (int), int (*crit2) (int),
+               const crit_range *range1, const crit_range *range2)
+{
+    if (len < 2)
         return 0;
+    crit_pair *scratch = (crit_pair *)malloc(len * sizeof(crit_pair));
+    if (!scratch)
+        return -1;
+
+    // первый проход: критерии считаются один раз, заодно уточняются диапазоны
+    crit_range r1, r2;
+    eval_pairs(array, len, crit1, crit2, scratch, &r1, &r2);
+    // заявленный диапазон должен покрывать фактический, иначе корзины разъедутся
+    if ((range1 && (r1.min < range1->min || r1.max > range1->max)) ||
+        (range2 && (r2.min < range2->min || r2.max > range2->max))) {
+        free(scratch);
+        return -1;
+    }
+    if (range1) r1 = *range1;
+    if (range2) r2 = *range2;
+
+    int64_t width1 = (int64_t)r1.max - r1.min + 1, width2 = (int64_t)r2.max - r2.min + 1;
+    // ширины до 2^32, произведение в int64_t переполнилось бы - сравниваем делением
+    if (width1 > RADIX_MAX_BUCKETS || width2 > RADIX_MAX_BUCKETS / width1) { // диапазон широк - подсчёт невыгоден
+        free(scratch);
+        return -1;
+    }
+    size_t buckets = (size_t)(width1 * width2);
+    size_t *count = (size_t *)calloc(buckets + 1, sizeof(size_t));
+    if (!count) {
+        free(scratch);
+        return -1;
+    }
+
+    // crit1 по возрастанию, crit2 по убыванию
+#define BUCKET(p) ((size_t)((p).c1 - r1.min) * (size_t)width2 + (size_t)(r2.max - (p).c2))
+    for (size_t i = 0; i < len; i++)
+        count[BUCKET(scratch[i]) + 1]++;
+    for (size_t b = 1; b <= buckets; b++)
+        count[b] += count[b - 1];
+    for (size_t i = 0; i < len; i++) // раскладка устойчива - равные остаются в порядке ввода
+        array[count[BUCKET(scratch[i])]++] = scratch[i].value;
+#undef BUCKET
+
+    free(count);
+    free(scratch);
+    return 0;
+}
+
+void sort(int * array, size_t len, int (*crit1) (int), int (*crit2) (int))
+{
+    // для известных критериев диапазоны заявлены, для прочих определяются по данным;
+    // если подсчёт не подходит - общий движок
+    const crit_range *range1 = crit1 == digit_count ? &DIGIT_COUNT_RANGE : NULL;
+    const crit_range *range2 = crit2 == prod_sum ? &PROD_SUM_RANGE : NULL;
+    if (len >= RADIX_THRESHOLD && radix_sort(array, len, crit1, crit2, range1, range2) == 0)
+        return;
+    key_sort(array, len, crit1, crit2);
+};
+
+/*
+ * Параллельная сортировка на pthreads: массив делится на threads непрерывных кусков,
+ * каждый поток считает критерии своего куска. Дальше при малых диапазонах -
+ * параллельная раскладка подсчётом, иначе - сортировка кусков и попарное слияние.
+ * Результат совпадает с sort() при любом числе потоков
+ */
+
+#define PARALLEL_MIN_CHUNK (1 << 16)
+
+typedef struct sort_task {
+    pthread_t thread;
+    int *array;
+    crit_pair *pairs;
+    sort_key *src, *dst;
+    size_t from, mid, to; // [from, to), mid - граница сливаемых серий
+    int (*crit1) (int);
+    int (*crit2) (int);
+    crit_range r1, r2; // фактические диапазоны куска
+    size_t *count; // корзины этого потока
+    size_t width2, min1, max2;
+} sort_task;
+
+void *eval_chunk(void *arg)
+{
+    sort_task *t = (sort_task *)arg;
+    eval_pairs(t->array + t->from, t->to - t->from, t->crit1, t->crit2,
+               t->pairs + t->from, &t->r1, &t->r2);
+    return NULL;
+}
+
+#define TASK_BUCKET(t, p) ((size_t)((p).c1 - (int)(t)->min1) * (t)->width2 + (size_t)((int)(t)->max2 - (p).c2))
+
+void *count_chunk(void *arg)
+{
+    sort_task *t = (sort_task *)arg;
+    for (size_t i = t->from; i < t->to; i++)
+        t->count[TASK_BUCKET(t, t->pairs[i])]++;
+    return NULL;
+}
+
+void *scatter_chunk(void *arg)
+{
+    sort_task *t = (sort_task *)arg;
+    for (size_t i = t->from; i < t->to; i++)
+        t->array[t->count[TASK_BUCKET(t, t->pairs[i])]++] = t->pairs[i].value;
+    return NULL;
+}
+
+#undef TASK_BUCKET
+
+void *sort_chunk(void *arg)
+{
+    sort_task *t = (sort_task *)arg;
+    for (size_t i = t->from; i < t->to; i++) {
+        t->src[i].key = pack_key(t->pairs[i].c1, t->pairs[i].c2);
+        t->src[i].pos = (uint32_t)i;
+        t->src[i].value = t->pairs[i].value;
+    }
+    introsort_keys(t->src + t->from, t->to - t->from);
+    return NULL;
+}
 
-    int * array = malloc(n * sizeof(int));
+void *merge_chunk(void *arg)
+{
+    sort_task *t = (sort_task *)arg;
+    size_t i = t->from, j = t->mid, k = t->from;
+    while (i < t->mid && j < t->to)
+        t->dst[k++] = key_less(&t->src[j], &t->src[i]) ? t->src[j++] : t->src[i++];
+    memcpy(t->dst + k, t->src + i, (t->mid - i) * sizeof(sort_key));
+    k += t->mid - i;
+    memcpy(t->dst + k, t->src + j, (t->to - j) * sizeof(sort_key));
+    return NULL;
+}
 
-    puts("\nEnter numbers:");
-    for (int i = 0; i < n; i++) 
-        scanf("%d", array+i);
+void run_tasks(sort_task *tasks, int count, void *(*fn) (void *))
+{
+    // поток, который не удалось создать, отрабатывает в вызывающем
+    int *started = (int *)calloc(count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+        if (started && pthread_create(&tasks[i].thread, NULL, fn, &tasks[i]) == 0)
+            started[i] = 1;
+        else
+            fn(&tasks[i]);
+    }
+    for (int i = 0; i < count; i++)
+        if (started && started[i])
+            pthread_join(tasks[i].thread, NULL);
+    free(started);
+}
 
-    puts("\nOriginal sequence:");
-    for (int i = 0; i < n; i++) {
-        printf("%d ", *(array+i));
+int parallel_radix(sort_task *tasks, int threads, crit_range r1, crit_range r2)
+{
+    int64_t width1 = (int64_t)r1.max - r1.min + 1, width2 = (int64_t)r2.max - r2.min + 1;
+    if (width1 > RADIX_MAX_BUCKETS || width2 > RADIX_MAX_BUCKETS / width1) // как в radix_sort
+        return -1;
+    size_t buckets = (size_t)(width1 * width2);
+    if (buckets > SIZE_MAX / (size_t)threads / sizeof(size_t)) // счётчики всех потоков
+        return -1;
+    size_t *counts = (size_t *)calloc(buckets * threads, sizeof(size_t));
+    if (!counts)
+        return -1;
+    for (int t = 0; t < threads; t++) {
+        tasks[t].count = counts + buckets * t;
+        tasks[t].width2 = (size_t)width2;
+        tasks[t].min1 = (size_t)r1.min;
+        tasks[t].max2 = (size_t)r2.max;
     }
+    run_tasks(tasks, threads, count_chunk);
 
-    sort(array, n, digit_count, prod_sum);
+    // смещения идут по корзинам, внутри корзины - по потокам в порядке кусков,
+    // поэтому раскладка устойчива так же, как последовательная
+    size_t offset = 0;
+    for (size_t b = 0; b < buckets; b++)
+        for (int t = 0; t < threads; t++) {
+            size_t c = tasks[t].count[b];
+            tasks[t].count[b] = offset;
+            offset += c;
+        }
+    run_tasks(tasks, threads, scatter_chunk);
+    free(counts);
+    return 0;
+}
 
-    puts("\nNew sequence:");
-    for (int i = 0; i < n; i++) {
-        printf("%d ", *(array+i));
+int parallel_merge_sort(sort_task *tasks, int threads, size_t len)
+{
+    sort_key *keys = (sort_key *)malloc(len * sizeof(sort_key));
+    sort_key *scratch = (sort_key *)malloc(len * sizeof(sort_key));
+    if (!keys || !scratch) {
+        free(keys);
+        free(scratch);
+        return -1;
+    }
+    size_t *bounds = (size_t *)malloc((threads + 1) * sizeof(size_t));
+    if (!bounds) {
+        free(keys);
+        free(scratch);
+        return -1;
     }
-    puts("\n");
+    for (int t = 0; t < threads; t++) {
+        tasks[t].src = keys;
+        bounds[t] = tasks[t].from;
+    }
+    bounds[threads] = len;
+    run_tasks(tasks, threads, sort_chunk);
 
-    free(array);
+    // раунды попарных слияний соседних серий, каждое слияние - в своём потоке
+    sort_key *src = keys, *dst = scratch;
+    int runs = threads;
+    while (runs > 1) {
+        int pairs = runs / 2;
+        for (int p = 0; p < pairs; p++) {
+            tasks[p].src = src;
+            tasks[p].dst = dst;
+            tasks[p].from = bounds[2 * p];
+            tasks[p].mid = bounds[2 * p + 1];
+            tasks[p].to = bounds[2 * p + 2];
+        }
+        run_tasks(tasks, pairs, merge_chunk);
+        if (runs % 2) // непарная последняя серия переносится как есть
+            memcpy(dst + bounds[runs - 1], src + bounds[runs - 1],
+                   (len - bounds[runs - 1]) * sizeof(sort_key));
+        for (int p = 0; p < pairs; p++)
+            bounds[p] = bounds[2 * p];
+        if (runs % 2)
+            bounds[pairs] = bounds[runs - 1];
+        runs = pairs + runs % 2;
+        bounds[runs] = len;
+        sort_key *temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    int *array = tasks[0].array;
+    for (size_t i = 0; i < len; i++)
+        array[i] = src[i].value;
+    free(bounds);
+    free(keys);
+    free(scratch);
+    return 0;
+}
+
+void parallel_sort(int * array, size_t len, int (*crit1) (int), int (*crit2) (int), int threads)
+{
+    if (threads <= 0) // 0 - по числу ядер
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t)threads > len / PARALLEL_MIN_CHUNK) // мелкие куски не окупают потоков
+        threads = (int)(len / PARALLEL_MIN_CHUNK);
+    if (threads <= 1) {
+        sort(array, len, crit1, crit2);
+        return;
+    }
+
+    sort_task *tasks = (sort_task *)calloc(threads, sizeof(sort_task));
+    crit_pair *pairs = (crit_pair *)malloc(len * sizeof(crit_pair));
+    if (!tasks || !pairs) {
+        free(tasks);
+        free(pairs);
+        sort(array, len, crit1, crit2);
+        return;
+    }
+    for (int t = 0; t < threads; t++) {
+        tasks[t].array = array;
+        tasks[t].pairs = pairs;
+        tasks[t].crit1 = crit1;
+        tasks[t].crit2 = crit2;
+        tasks[t].from = len * t / threads;
+        tasks[t].to = len * (t + 1) / threads;
+    }
+    run_tasks(tasks, threads, eval_chunk);
+
+    crit_range r1 = tasks[0].r1, r2 = tasks[0].r2;
+    for (int t = 1; t < threads; t++) {
+        if (tasks[t].r1.min < r1.min) r1.min = tasks[t].r1.min;
+        if (tasks[t].r1.max > r1.max) r1.max = tasks[t].r1.max;
+        if (tasks[t].r2.min < r2.min) r2.min = tasks[t].r2.min;
+        if (tasks[t].r2.max > r2.max) r2.max = tasks[t].r2.max;
+    }
+
+    if (parallel_radix(tasks, threads, r1, r2) != 0 &&
+        parallel_merge_sort(tasks, threads, len) != 0) {
+        free(tasks);
+        free(pairs);
+        key_sort(array, len, crit1, crit2); // памяти на параллельный путь не хватило
+        return;
+    }
+    free(tasks);
+    free(pairs);
+}
+
+/*
+ * Быстрый ввод-вывод: целые разбираются прямо из большого буфера
+ * (или из отображённого в память файла), вывод копится в буфере и уходит одним write
+ */
+
+#define IO_BUFFER_SIZE (1 << 20)
+#define INT_TOKEN_MAX 64 // в буфере перед разбором числа должно быть хотя бы столько байт
+
+typedef struct int_reader {
+    int fd;
+    char *buf; // собственный буфер, NULL при mmap
+    const char *cur, *end;
+    void *map;
+    size_t mapLen;
+    int eof; // больше читать нечего, всё оставшееся - между cur и end
+} int_reader;
+
+int reader_open(int_reader *r, int fd)
+{
+    memset(r, 0, sizeof(int_reader));
+    r->fd = fd;
+    struct stat st;
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && offset >= 0 && st.st_size > offset) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            r->map = map;
+            r->mapLen = st.st_size;
+            r->cur = (const char *)map + offset;
+            r->end = (const char *)map + st.st_size;
+            r->eof = 1;
+            return 0;
+        }
+    }
+    r->buf = (char *)malloc(IO_BUFFER_SIZE);
+    if (!r->buf)
+        return -1;
+    r->cur = r->end = r->buf;
+    return 0;
+}
+
+void reader_close(int_reader *r)
+{
+    if (r->map)
+        munmap(r->map, r->mapLen);
+    free(r->buf);
+}
+
+void reader_fill(int_reader *r)
+{
+    if (r->eof)
+        return;
+    // недоразобранный хвост переносится в начало буфера
+    size_t rest = r->end - r->cur;
+    memmove(r->buf, r->cur, rest);
+    r->cur = r->buf;
+    r->end = r->buf + rest;
+    // последнее число дописано до пробела - с терминала больше не ждём
+    while (r->end - r->cur < INT_TOKEN_MAX
+           && (r->end == r->cur || !isspace((unsigned char)r->end[-1]))) {
+        ssize_t got = read(r->fd, (char *)r->end, IO_BUFFER_SIZE - (r->end - r->buf));
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0) {
+            r->eof = 1;
+            return;
+        }
+        r->end += got;
+    }
+}
+
+// 1 - число прочитано, 0 - конец ввода, -1 - на входе не число или оно не влезает в int
+int read_int(int_reader *r, int *out)
+{
+    for (;;) {
+        while (r->cur < r->end && isspace((unsigned char)*r->cur))
+            r->cur++;
+        if (r->cur < r->end)
+            break;
+        if (r->eof)
+            return 0;
+        reader_fill(r);
+    }
+    if (r->end - r->cur < INT_TOKEN_MAX)
+        reader_fill(r);
+
+    const char *p = r->cur;
+    int neg = 0;
+    if (*p == '-' || *p == '+')
+        neg = *p++ == '-';
+    if (p == r->end || !isdigit((unsigned char)*p))
+        return -1;
+    int64_t value = 0;
+    while (p < r->end && isdigit((unsigned char)*p)) {
+        value = value * 10 + (*p++ - '0');
+        if (value > (int64_t)INT_MAX + neg)
+            return -1;
+    }
+    *out = (int)(neg ? -value : value);
+    r->cur = p;
+    return 1;
+}
+
+// весь оставшийся ввод как массив int32 в порядке байт машины
+int *read_binary(int_reader *r, size_t *len)
+{
+    size_t cap = r->map ? (size_t)(r->end - r->cur) / sizeof(int) + 1 : IO_BUFFER_SIZE / sizeof(int);
+    size_t bytes = 0;
+    char *data = (char *)malloc(cap * sizeof(int));
+    if (!data)
+        return NULL;
+    for (;;) {
+        size_t avail = r->end - r->cur;
+        if (bytes + avail > cap * sizeof(int)) {
+            while (bytes + avail > cap * sizeof(int))
+                cap *= 2;
+            char *grown = (char *)realloc(data, cap * sizeof(int));
+            if (!grown) {
+                free(data);
+                return NULL;
+            }
+            data = grown;
+        }
+        memcpy(data + bytes, r->cur, avail);
+        bytes += avail;
+        r->cur = r->end;
+        if (r->eof)
+            break;
+        reader_fill(r);
+    }
+    if (bytes % sizeof(int)) { // обрывок последнего числа
+        free(data);
+        return NULL;
+    }
+    *len = bytes / sizeof(int);
+    return (int *)data;
+}
+
+typedef struct int_writer {
+    int fd;
+    char *buf;
+    size_t len;
+    int failed;
+} int_writer;
+
+int writer_open(int_writer *w, int fd)
+{
+    w->fd = fd;
+    w->len = 0;
+    w->failed = 0;
+    w->buf = (char *)malloc(IO_BUFFER_SIZE);
+    return w->buf ? 0 : -1;
+}
+
+void write_all(int_writer *w, const char *data, size_t len)
+{
+    while (len > 0 && !w->failed) {
+        ssize_t put = write(w->fd, data, len);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put <= 0) {
+            w->failed = 1;
+            return;
+        }
+        data += put;
+        len -= put;
+    }
+}
+
+void writer_flush(int_writer *w)
+{
+    write_all(w, w->buf, w->len);
+    w->len = 0;
+}
+
+int writer_close(int_writer *w)
+{
+    writer_flush(w);
+    free(w->buf);
+    return w->failed ? -1 : 0;
+}
+
+void write_bytes(int_writer *w, const void *data, size_t len)
+{
+    if (w->len + len > IO_BUFFER_SIZE)
+        writer_flush(w);
+    if (len > IO_BUFFER_SIZE) { // большие куски - мимо буфера
+        write_all(w, (const char *)data, len);
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+void write_str(int_writer *w, const char *str)
+{
+    write_bytes(w, str, strlen(str));
+}
+
+// число и разделитель; цифры пишутся парами по таблице, без деления на каждую
+void write_int(int_writer *w, int value, char sep)
+{
+    static const char pairs[201] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char tmp[16];
+    char *p = tmp + sizeof(tmp);
+    *--p = sep;
+    uint32_t u = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    while (u >= 100) {
+        uint32_t pair = u % 100;
+        u /= 100;
+        p -= 2;
+        memcpy(p, pairs + 2 * pair, 2);
+    }
+    if (u >= 10) {
+        p -= 2;
+        memcpy(p, pairs + 2 * u, 2);
+    } else
+        *--p = (char)('0' + u);
+    if (value < 0)
+        *--p = '-';
+    write_bytes(w, p, tmp + sizeof(tmp) - p);
+}
+
+void write_sequence(int_writer *w, const int *array, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        write_int(w, array[i], ' ');
+}
+
+#ifdef BENCHMARK
+
+/*
+ * Замер скорости: gcc -O2 -pthread -DBENCHMARK -o bench 0_.c
+ * ./bench [max_exp [selection_max_exp [threads]]] - размеры 10^4 .. 10^max_exp (по умолчанию 10^7),
+ * сортировка выбором замеряется только до 10^selection_max_exp (по умолчанию 10^4),
+ * parallel_sort - на threads потоках (по умолчанию 0, по числу ядер)
+ */
+
+#include <time.h>
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void fill_random(int *array, size_t len, uint64_t seed)
+{
+    for (size_t i = 0; i < len; i++) { // xorshift64, rand() слишком медленный для 10^8
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        array[i] = (int)(seed & 0x7FFFFFFF);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int maxExp = argc > 1 ? atoi(argv[1]) : 7;
+    int selectionExp = argc > 2 ? atoi(argv[2]) : 4;
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+    printf("%12s %14s %14s %14s %14s %14s\n", "n", "selection", "key_sort", "radix(auto)", "radix(decl)", "parallel");
+    size_t len = 10000;
+    for (int e = 4; e <= maxExp; e++, len *= 10) {
+        int *source = (int *)malloc(len * sizeof(int));
+        int *array = (int *)malloc(len * sizeof(int));
+        if (!source || !array) {
+            printf("%12zu out of memory\n", len);
+            free(source);
+            free(array);
+            break;
+        }
+        fill_random(source, len, 0x9E3779B97F4A7C15ull + e);
+        printf("%12zu", len);
+
+        if (e <= selectionExp) {
+            memcpy(array, source, len * sizeof(int));
+            double t = now_sec();
+            selection_sort(array, len, digit_count, prod_sum);
+            printf(" %13.4fs", now_sec() - t);
+        } else
+            printf(" %14s", "-");
+
+        memcpy(array, source, len * sizeof(int));
+        double t = now_sec();
+        key_sort(array, len, digit_count, prod_sum);
+        printf(" %13.4fs", now_sec() - t);
+
+        memcpy(array, source, len * sizeof(int));
+        t = now_sec();
+        int rc = radix_sort(array, len, digit_count, prod_sum, NULL, NULL);
+        if (rc == 0) printf(" %13.4fs", now_sec() - t); else printf(" %14s", "failed");
+
+        memcpy(array, source, len * sizeof(int));
+        t = now_sec();
+        rc = radix_sort(array, len, digit_count, prod_sum, &DIGIT_COUNT_RANGE, &PROD_SUM_RANGE);
+        if (rc == 0) printf(" %13.4fs", now_sec() - t); else printf(" %14s", "failed");
+
+        memcpy(array, source, len * sizeof(int));
+        t = now_sec();
+        parallel_sort(array, len, digit_count, prod_sum, threads);
+        printf(" %13.4fs", now_sec() - t);
+        putchar('\n');
+
+        free(source);
+        free(array);
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+#else
+
+// приглашения идут через stdio и сбрасываются до блокирующего чтения,
+// так что к первому выводу writer'а в stdout ничего не остаётся
+void prompt(const char *text)
+{
+    fputs(text, stdout);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    int threads = 1; // число потоков сортировки, 0 - по числу ядер
+    int binaryIn = 0, binaryOut = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:io")) != -1) {
+        switch (opt) {
+        case 't': threads = atoi(optarg); break;
+        case 'i': binaryIn = 1; break;
+        case 'o': binaryOut = 1; break;
+        default:
+            fprintf(stderr, "Usage: %s [-t threads] [-i] [-o]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int_reader in;
+    int_writer out;
+    if (reader_open(&in, STDIN_FILENO) != 0 || writer_open(&out, STDOUT_FILENO) != 0) {
+        printf("Memory allocation error");
+        return 1;
+    }
+
+    int *array = NULL;
+    size_t n = 0;
+    if (binaryIn) {
+        array = read_binary(&in, &n);
+        if (!array) {
+            fprintf(stderr, "Binary input is truncated or too large\n");
+            reader_close(&in);
+            writer_close(&out);
+            return 1;
+        }
+    } else {
+        int count = 0;
+        if (!binaryOut)
+            prompt("\nEnter the number of numbers:\n");
+        if (read_int(&in, &count) != 1 || count <= 0) {
+            reader_close(&in);
+            writer_close(&out);
+            return 0;
+        }
+        array = (int *)malloc(count * sizeof(int));
+        if (!array) {
+            printf("Memory allocation error");
+            reader_close(&in);
+            writer_close(&out);
+            return 1;
+        }
+        if (!binaryOut)
+            prompt("\nEnter numbers:\n");
+        while (n < (size_t)count && read_int(&in, &array[n]) == 1) // при нехватке чисел сортируем прочитанные
+            n++;
+    }
+    reader_close(&in);
+
+    if (!binaryOut) {
+        write_str(&out, "\nOriginal sequence:\n");
+        write_sequence(&out, array, n);
+    }
+
+    parallel_sort(array, n, digit_count, prod_sum, threads);
+
+    if (binaryOut)
+        write_bytes(&out, array, n * sizeof(int));
+    else {
+        write_str(&out, "\nNew sequence:\n");
+        write_sequence(&out, array, n);
+        write_str(&out, "\n\n");
+    }
+
+    free(array);
+    return writer_close(&out) == 0 ? 0 : 1;
+}
+
+#endif // BENCHMARK
+
+/*
+ * gcc -O2 -pthread -o 0_ 0_.c - компиляция
+ * ./0_ [-t threads] [-i] [-o] - запуск
+ *     -t - число потоков сортировки (по умолчанию 1, 0 - по числу ядер)
+ *     -i - на входе сырые int32 до конца файла, без количества и приглашений
+ *     -o - на выходе только отсортированные числа сырыми int32
+ */
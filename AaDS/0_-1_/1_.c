@@ -1,77 +1,271 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
 
-void inputMatrix(int ***matrix, int *rowNum, int **rowSizes)
-{
-    scanf("%d", rowNum);
-    *rowSizes = (int *)malloc(*rowNum * sizeof(int));
-    *matrix = (int **)malloc(*rowNum * sizeof(int *)); // создание массива указателей на строки
-
-    for (int i = 0; i < *rowNum; i ++ ) {
-        scanf("%d", &(*rowSizes)[i]);
-        // инициализация значения под указателем в массиве указателей массивом
-        (*matrix)[i] = (int *)malloc((*rowSizes)[i] * sizeof(int)); 
-        for (int j = 0; j < (*rowSizes)[i]; j++) {
-            scanf("%d", &(*matrix)[i][j]);
-        }
-    }
-}
+#define TRANSFORM_MIN_CHUNK (1 << 16)
 
-int **transformMatrix(int **matrix, int rowNum, int *rowSizes, int **newRowSizes)
+/*
+ * Матрица хранится сжатыми строками: все элементы лежат подряд в values,
+ * строка i - это values[rowStart[i] .. rowEnd[i]). У исходной матрицы
+ * rowEnd указывает на rowStart + 1, так что смещений всего rowNum + 1
+ */
+typedef struct Matrix {
+    int *values;
+    size_t *rowStart;
+    size_t *rowEnd;
+    int rowNum;
+} Matrix;
+
+int inputMatrix(Matrix *matrix)
 {
-    int **newMatrix = (int **)malloc(rowNum * sizeof(int *)); // создание массива указателей на строки
-    *newRowSizes = (int *)malloc(rowNum * sizeof(int));
+    matrix->values = NULL;
+    matrix->rowStart = matrix->rowEnd = NULL;
+    matrix->rowNum = 0;
+
+    int rowNum;
+    if (scanf("%d", &rowNum) != 1 || rowNum < 0)
+        return -1;
+    size_t *offsets = (size_t *)malloc((rowNum + 1) * sizeof(size_t));
+    if (!offsets)
+        return -1;
+
+    size_t capacity = 16, total = 0;
+    int *values = (int *)malloc(capacity * sizeof(int));
+    if (!values) {
+        free(offsets);
+        return -1;
+    }
 
     for (int i = 0; i < rowNum; i++) {
-        int minIndex = 0;
-        for (int j = 1; j < rowSizes[i]; j++) {
-            if (matrix[i][j] < matrix[i][minIndex]){
-                minIndex = j;
+        int rowSize;
+        offsets[i] = total;
+        if (scanf("%d", &rowSize) != 1 || rowSize < 0)
+            rowSize = 0;
+        if (total + rowSize > capacity) { // буфер растёт удвоением, а не по блоку на строку
+            while (total + rowSize > capacity)
+                capacity *= 2;
+            int *grown = (int *)realloc(values, capacity * sizeof(int));
+            if (!grown) {
+                free(values);
+                free(offsets);
+                return -1;
             }
+            values = grown;
         }
-        (*newRowSizes)[i] = rowSizes[i] - minIndex;
-        newMatrix[i] = (int *)malloc((*newRowSizes)[i] * sizeof(int));
-        for (int j = 0; j < (*newRowSizes)[i]; j++) {
-            newMatrix[i][j] = matrix[i][minIndex + j];
+        for (int j = 0; j < rowSize; j++) {
+            scanf("%d", &values[total++]);
         }
     }
-    return newMatrix;
+    offsets[rowNum] = total;
+
+    matrix->values = values;
+    matrix->rowStart = offsets;
+    matrix->rowEnd = offsets + 1;
+    matrix->rowNum = rowNum;
+    return 0;
+}
+
+/*
+ * Поиск первого минимума строки. Векторный вариант сначала сводит минимум
+ * по 8 полосам, потом вторым проходом ищет первое его вхождение
+ */
+
+typedef size_t (*argmin_kernel) (const int *, size_t);
+
+size_t rowArgminScalar(const int *row, size_t len)
+{
+    size_t minIndex = 0;
+    for (size_t j = 1; j < len; j++) {
+        if (row[j] < row[minIndex]){
+            minIndex = j;
+        }
+    }
+    return minIndex;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+size_t rowArgminAvx2(const int *row, size_t len)
+{
+    if (len < 16)
+        return rowArgminScalar(row, len);
+
+    __m256i vmin = _mm256_loadu_si256((const __m256i *)row);
+    size_t j = 8;
+    for (; j + 8 <= len; j += 8)
+        vmin = _mm256_min_epi32(vmin, _mm256_loadu_si256((const __m256i *)(row + j)));
+    __m128i m = _mm_min_epi32(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, 0x4E));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, 0xB1));
+    int minValue = _mm_cvtsi128_si32(m);
+    for (; j < len; j++)
+        if (row[j] < minValue)
+            minValue = row[j];
+
+    // восстановление индекса: первая восьмёрка, где есть минимум
+    __m256i target = _mm256_set1_epi32(minValue);
+    for (j = 0; j + 8 <= len; j += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(row + j)), target);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask)
+            return j + __builtin_ctz(mask);
+    }
+    while (row[j] != minValue)
+        j++;
+    return j;
+}
+
+argmin_kernel selectArgminKernel(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? rowArgminAvx2 : rowArgminScalar;
+}
+
+#else
+
+argmin_kernel selectArgminKernel(void)
+{
+    return rowArgminScalar;
+}
+
+#endif
+
+/*
+ * Строки делятся между потоками по числу элементов, а не строк: граница куска t -
+ * первая строка, начинающаяся не раньше total * t / threads. Так длинные строки
+ * не собираются у одного потока
+ */
+
+typedef struct TransformTask {
+    pthread_t thread;
+    const Matrix *matrix;
+    size_t *newRowStart;
+    int fromRow, toRow;
+    argmin_kernel argmin;
+    int started;
+} TransformTask;
+
+void *transformRows(void *arg)
+{
+    TransformTask *task = (TransformTask *)arg;
+    const Matrix *matrix = task->matrix;
+    for (int i = task->fromRow; i < task->toRow; i++) {
+        size_t start = matrix->rowStart[i], len = matrix->rowEnd[i] - start;
+        task->newRowStart[i] = start + (len ? task->argmin(matrix->values + start, len) : 0);
+    }
+    return NULL;
 }
 
-void printMatrix(int **matrix, int rowNum, int *rowSizes, const char *title)
+// первая строка, начало которой не меньше offset (rowStart исходной матрицы не убывает)
+int firstRowFrom(const Matrix *matrix, size_t offset)
+{
+    int lo = 0, hi = matrix->rowNum;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (matrix->rowStart[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// новая матрица - представление исходной: те же values и концы строк, свои только начала
+int transformMatrix(const Matrix *matrix, Matrix *newMatrix, int threads)
+{
+    newMatrix->rowStart = (size_t *)malloc((matrix->rowNum + 1) * sizeof(size_t));
+    if (!newMatrix->rowStart)
+        return -1;
+    newMatrix->values = matrix->values;
+    newMatrix->rowEnd = matrix->rowEnd;
+    newMatrix->rowNum = matrix->rowNum;
+
+    size_t total = matrix->rowNum ? matrix->rowEnd[matrix->rowNum - 1] : 0;
+    if (threads <= 0) // 0 - по числу ядер
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t)threads > total / TRANSFORM_MIN_CHUNK) // мелкие куски не окупают потоков
+        threads = (int)(total / TRANSFORM_MIN_CHUNK);
+    if (threads < 1)
+        threads = 1;
+
+    TransformTask *tasks = (TransformTask *)malloc(threads * sizeof(TransformTask));
+    if (!tasks) {
+        free(newMatrix->rowStart);
+        return -1;
+    }
+    argmin_kernel argmin = selectArgminKernel();
+    for (int t = 0; t < threads; t++) {
+        tasks[t].matrix = matrix;
+        tasks[t].newRowStart = newMatrix->rowStart;
+        tasks[t].argmin = argmin;
+        tasks[t].fromRow = t ? tasks[t - 1].toRow : 0;
+        tasks[t].toRow = t == threads - 1 ? matrix->rowNum : firstRowFrom(matrix, total / threads * (t + 1));
+    }
+    // нулевой кусок обрабатывает сам вызывающий поток; не созданный поток - тоже он
+    for (int t = 1; t < threads; t++)
+        tasks[t].started = pthread_create(&tasks[t].thread, NULL, transformRows, &tasks[t]) == 0;
+    transformRows(&tasks[0]);
+    for (int t = 1; t < threads; t++) {
+        if (tasks[t].started)
+            pthread_join(tasks[t].thread, NULL);
+        else
+            transformRows(&tasks[t]);
+    }
+    free(tasks);
+    return 0;
+}
+
+void printMatrix(const Matrix *matrix, const char *title)
 {
     printf("%s\n", title);
-    for (int i = 0; i < rowNum; i++) {
-        for (int j = 0; j < rowSizes[i]; j++) {
-            printf("%d ", matrix[i][j]);
+    for (int i = 0; i < matrix->rowNum; i++) {
+        for (size_t j = matrix->rowStart[i]; j < matrix->rowEnd[i]; j++) {
+            printf("%d ", matrix->values[j]);
         }
         putchar('\n');
     }
 }
 
-void freeMatrix(int **matrix, int rowNum)
+void freeMatrix(Matrix *matrix)
 {
-    for (int i = 0; i < rowNum; i++) {
-        free(matrix[i]);
-    }
-    free(matrix);
+    free(matrix->values);
+    free(matrix->rowStart); // rowEnd лежит в том же блоке
 }
 
-int main()
+void freeView(Matrix *view)
 {
-    int **matrix, *rowSizes, rowNum;
+    free(view->rowStart); // values и rowEnd принадлежат исходной матрице
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 0; // число потоков преобразования, 0 - по числу ядер
+    Matrix matrix, newMatrix;
 
-    inputMatrix(&matrix, &rowNum, &rowSizes);
-    printMatrix(matrix, rowNum, rowSizes, "Original matrix:");
+    if (inputMatrix(&matrix) != 0) {
+        printf("Input error");
+        return 1;
+    }
+    printMatrix(&matrix, "Original matrix:");
     
-    int **newMatrix, *newRowSizes;
-    newMatrix = transformMatrix(matrix, rowNum, rowSizes, &newRowSizes);
-    printMatrix(newMatrix, rowNum, newRowSizes, "Transformed matrix:");
+    if (transformMatrix(&matrix, &newMatrix, threads) != 0) {
+        printf("Memory allocation error");
+        freeMatrix(&matrix);
+        return 1;
+    }
+    printMatrix(&newMatrix, "Transformed matrix:");
 
-    freeMatrix(matrix, rowNum);
-    freeMatrix(newMatrix, rowNum);
-    free(rowSizes);
-    free(newRowSizes);
+    freeView(&newMatrix);
+    freeMatrix(&matrix);
 
     return 0;
-}
\ No newline at end of file
+}
+
+/*
+ * gcc -O2 -pthread -o 1_ 1_.c - компиляция
+ * ./1_ [threads] - запуск, threads - число потоков преобразования (по умолчанию 0, по числу ядер)
+ */
@@ -1,105 +1,1151 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "queue.h"
+#include "trace.h"
 
 
-#define PASSENGERS_NUM 10
-#define QUEUE_CAPACITY 3
+#define QUEUE_CAPACITY 3 // ёмкость стойки по умолчанию
+#define INPUT_MAX_TIME 100 // горизонт для пассажиров из ввода, как в исходной постановке
 
-int main() 
-{   
-    // вводим число стоек в аэропорту 
+/*
+ * Генератор псевдослучайных чисел xoshiro256**: состояние у каждого владельца
+ * своё (никакого общего rand()), так что потоки не мешают друг другу,
+ * а одинаковое зерно даёт одинаковый прогон
+ */
+
+typedef struct Rng {
+    uint64_t s[4];
+} Rng;
+
+static uint64_t splitMix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// stream разводит независимые последовательности при одном зерне
+static void rngSeed(Rng *r, uint64_t seed, uint64_t stream)
+{
+    uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ull);
+    for (int i = 0; i < 4; i++) {
+        r->s[i] = splitMix64(&x);
+    }
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t rngNext(Rng *r)
+{
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// число в [0, n) умножением вместо деления (n < 2^32)
+static uint32_t rngBelow(Rng *r, uint32_t n)
+{
+    return (uint32_t)(((rngNext(r) >> 32) * (uint64_t)n) >> 32);
+}
+
+// число в [0, 1)
+static double rngUnit(Rng *r)
+{
+    return (rngNext(r) >> 11) * 0x1.0p-53;
+}
+
+/*
+ * Источник пассажиров: либо читаем по одному из ввода, либо генерируем
+ * синтетическую нагрузку. В памяти одновременно только те пассажиры,
+ * что ещё не встали в очередь, поэтому поток может быть сколь угодно длинным
+ */
+
+typedef struct Source {
+    int synthetic;
+    int done;
+    long long left; // сколько ещё сгенерировать
+    long long made;
+    double clock; // время прибытия последнего сгенерированного
+    double meanGap; // средний интервал между прибытиями
+    int maxTs; // время обслуживания равномерно в [1, maxTs]
+    Rng rng;
+} Source;
+
+static int nextPassenger(Source *src, Passenger *p)
+{
+    if (src->done) return 0;
+    if (src->synthetic) {
+        if (src->left == 0) {
+            src->done = 1;
+            return 0;
+        }
+        src->left--;
+        src->clock += 2.0 * src->meanGap * rngUnit(&src->rng);
+        snprintf(p->id, sizeof(p->id), "p%lld", src->made++);
+        p->ta = src->clock < INT_MAX ? (int)src->clock : INT_MAX;
+        p->ts = 1 + (int)rngBelow(&src->rng, (uint32_t)src->maxTs);
+        return 1;
+    }
+    // пассажиры записаны в одну строку через пробел: id/ta/ts
+    if (scanf(" %15[^/]/%d/%d", p->id, &p->ta, &p->ts) != 3) {
+        src->done = 1;
+        return 0;
+    }
+    src->made++;
+    char isOver;
+    if (scanf("%c", &isOver) != 1 || isOver == '\n') src->done = 1;
+    return 1;
+}
+
+/*
+ * Дискретно-событийная модель: вместо перебора всех тактов и всех пассажиров
+ * храним кучу будущих событий (прибытие пассажира и окончание обслуживания
+ * на стойке) и прыгаем сразу к ближайшему
+ */
+
+enum { EV_ARRIVAL, EV_DEPARTURE }; // в один такт сначала прибытия, затем уходы
+
+typedef struct Event {
+    int time;
+    int kind;
+    long long index; // номер пассажира во вводе для прибытия, номер стойки для ухода
+    Passenger p; // прибывающий пассажир
+} Event;
+
+// 4-арная куча: дерево ниже, чем у двоичной, и дети узла лежат рядом в памяти
+typedef struct EventHeap {
+    Event *items;
+    size_t size;
+    size_t cap;
+} EventHeap;
+
+static int eventLess(const Event *a, const Event *b)
+{
+    if (a->time != b->time) return a->time < b->time;
+    if (a->kind != b->kind) return a->kind < b->kind;
+    // порядок внутри такта как у прежнего цикла: по номеру пассажира/стойки
+    return a->index < b->index;
+}
+
+static void heapPush(EventHeap *h, const Event *e)
+{
+    if (h->size == h->cap) {
+        h->cap = h->cap ? h->cap * 2 : 64;
+        h->items = realloc(h->items, h->cap * sizeof(Event));
+        if (!h->items) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+            exit(1);
+        }
+    }
+    size_t i = h->size++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 4;
+        if (!eventLess(e, &h->items[parent])) break;
+        h->items[i] = h->items[parent];
+        i = parent;
+    }
+    h->items[i] = *e;
+}
+
+static void heapPop(EventHeap *h, Event *top)
+{
+    *top = h->items[0];
+    Event *last = &h->items[--h->size];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 4 * i + 1;
+        if (child >= h->size) break;
+        size_t end = child + 4 < h->size ? child + 4 : h->size;
+        size_t best = child;
+        for (size_t c = child + 1; c < end; c++) {
+            if (eventLess(&h->items[c], &h->items[best])) best = c;
+        }
+        if (!eventLess(&h->items[best], last)) break;
+        h->items[i] = h->items[best];
+        i = best;
+    }
+    h->items[i] = *last;
+}
+
+static void pushDeparture(EventHeap *h, int time, int desk)
+{
+    Event e = {.time = time, .kind = EV_DEPARTURE, .index = desk};
+    heapPush(h, &e);
+}
+
+// ts = 1 значит, что пассажир уходит в тот же такт, когда встал к стойке
+static int serviceEnd(int start, int ts)
+{
+    return start + (ts > 0 ? ts : 1) - 1;
+}
+
+static double nowSec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Политики выбора стойки. Балансировщик видит только размеры очередей
+ * и суммарное время обслуживания стоящих в них (work). Их держат отдельно
+ * от самих очередей в атомарных ячейках: при разбиении на потоки стойки
+ * принадлежат чужим потокам, а читать их длины нужно без блокировок.
+ * Пишут в ячейку стойки по очереди, никогда одновременно, поэтому хватает
+ * relaxed-загрузки и записи без атомарного сложения
+ */
+
+typedef struct Balancer {
     int desksNum;
-    scanf("%d ", &desksNum);
-    
-    // создаёи массив очередей по числу стоек
-    Queue *desks[desksNum];
+    _Atomic int *sizes; // длина очереди стойки
+    _Atomic long long *work; // сумма ts пассажиров в очереди стойки
+    int choices; // d для d-choices
+    int nextDesk; // для round-robin
+    Rng rng;
+} Balancer;
+
+static int deskSize(const Balancer *b, int desk)
+{
+    return atomic_load_explicit(&b->sizes[desk], memory_order_relaxed);
+}
+
+static long long deskWork(const Balancer *b, int desk)
+{
+    return atomic_load_explicit(&b->work[desk], memory_order_relaxed);
+}
+
+static void updateDesk(Balancer *b, int desk, int dSize, long long dWork)
+{
+    atomic_store_explicit(&b->sizes[desk], deskSize(b, desk) + dSize, memory_order_relaxed);
+    atomic_store_explicit(&b->work[desk], deskWork(b, desk) + dWork, memory_order_relaxed);
+}
+
+static int initBalancer(Balancer *b, int desksNum, int choices, uint64_t seed)
+{
+    b->desksNum = desksNum;
+    b->choices = choices;
+    b->nextDesk = 0;
+    rngSeed(&b->rng, seed, 0);
+    b->sizes = malloc(desksNum * sizeof(_Atomic int));
+    b->work = malloc(desksNum * sizeof(_Atomic long long));
+    if (!b->sizes || !b->work) return 0;
     for (int i = 0; i < desksNum; i++) {
-        desks[i] = createQueue(QUEUE_CAPACITY);
+        atomic_init(&b->sizes[i], 0);
+        atomic_init(&b->work[i], 0);
     }
-    
-    Passenger passengers[PASSENGERS_NUM];
-    int totPass = 0;
-    Passenger *p = passengers;
+    return 1;
+}
+
+static void freeBalancer(Balancer *b)
+{
+    free(b->sizes);
+    free(b->work);
+}
+
+typedef struct Policy {
+    const char *name;
+    int (*choose)(Balancer *b);
+} Policy;
+
+// две разные случайные стойки, берём более короткую (при равенстве первую)
+static int chooseP2C(Balancer *b)
+{
+    int idx1 = (int)rngBelow(&b->rng, (uint32_t)b->desksNum);
+    int idx2 = idx1;
+    while (b->desksNum > 1 && idx1 == idx2) {
+        idx2 = (int)rngBelow(&b->rng, (uint32_t)b->desksNum);
+    }
+    return deskSize(b, idx1) > deskSize(b, idx2) ? idx2 : idx1;
+}
+
+// d случайных стоек (возможны повторы), самая короткая из них
+static int chooseDChoices(Balancer *b)
+{
+    int best = (int)rngBelow(&b->rng, (uint32_t)b->desksNum);
+    int bestSize = deskSize(b, best);
+    for (int i = 1; i < b->choices; i++) {
+        int idx = (int)rngBelow(&b->rng, (uint32_t)b->desksNum);
+        int size = deskSize(b, idx);
+        if (size < bestSize) {
+            best = idx;
+            bestSize = size;
+        }
+    }
+    return best;
+}
+
+// самая короткая очередь среди всех, O(desksNum) на решение
+static int chooseJSQ(Balancer *b)
+{
+    int best = 0;
+    int bestSize = deskSize(b, 0);
+    for (int i = 1; i < b->desksNum && bestSize > 0; i++) {
+        int size = deskSize(b, i);
+        if (size < bestSize) {
+            best = i;
+            bestSize = size;
+        }
+    }
+    return best;
+}
+
+static int chooseRoundRobin(Balancer *b)
+{
+    int idx = b->nextDesk;
+    b->nextDesk = idx + 1 == b->desksNum ? 0 : idx + 1;
+    return idx;
+}
+
+// стойка с наименьшей суммой ts в очереди, O(desksNum) на решение
+static int chooseLeastWork(Balancer *b)
+{
+    int best = 0;
+    long long bestWork = deskWork(b, 0);
+    for (int i = 1; i < b->desksNum && bestWork > 0; i++) {
+        long long w = deskWork(b, i);
+        if (w < bestWork) {
+            best = i;
+            bestWork = w;
+        }
+    }
+    return best;
+}
+
+static const Policy policies[] = {
+    {"p2c", chooseP2C},
+    {"d-choices", chooseDChoices},
+    {"jsq", chooseJSQ},
+    {"rr", chooseRoundRobin},
+    {"lrw", chooseLeastWork},
+};
+
+#define POLICIES_NUM (int)(sizeof(policies) / sizeof(policies[0]))
+
+/*
+ * Запись двоичной трассы (формат - в trace.h) через большой буфер:
+ * на событие уходит несколько байт вместо снимка всех стоек
+ */
+
+#define TRACE_BUFFER (1 << 20)
+#define TRACE_RECORD_MAX (1 + 10 + 10 + 1 + sizeof(((Passenger *)0)->id))
+
+typedef struct TraceWriter {
+    FILE *f;
+    unsigned char *buf;
+    size_t len;
+    int lastTime;
+    long long rejects; // отказы такта rejectTime, ещё не записанные
+    int rejectTime;
+    int failed;
+} TraceWriter;
+
+static void traceFlush(TraceWriter *tw)
+{
+    if (tw->len && fwrite(tw->buf, 1, tw->len, tw->f) != tw->len) tw->failed = 1;
+    tw->len = 0;
+}
+
+static void tracePutVarint(TraceWriter *tw, uint64_t x)
+{
+    while (x >= 0x80) {
+        tw->buf[tw->len++] = (unsigned char)(x | 0x80);
+        x >>= 7;
+    }
+    tw->buf[tw->len++] = (unsigned char)x;
+}
+
+static int traceOpen(TraceWriter *tw, const char *path, int desksNum, size_t capacity)
+{
+    tw->f = fopen(path, "wb");
+    tw->buf = malloc(TRACE_BUFFER);
+    tw->len = 0;
+    tw->lastTime = 0;
+    tw->rejects = 0;
+    tw->failed = 0;
+    if (!tw->f || !tw->buf) {
+        if (tw->f) fclose(tw->f);
+        free(tw->buf);
+        return 0;
+    }
+    memcpy(tw->buf, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    tw->len = TRACE_MAGIC_LEN;
+    tracePutVarint(tw, (uint64_t)desksNum);
+    tracePutVarint(tw, capacity);
+    return 1;
+}
+
+// счётчик отказов закончившегося такта - одной записью
+static void traceFlushRejects(TraceWriter *tw)
+{
+    if (tw->rejects == 0) return;
+    if (tw->len + TRACE_RECORD_MAX > TRACE_BUFFER) traceFlush(tw);
+    tw->buf[tw->len++] = TRACE_REJECT;
+    tracePutVarint(tw, (uint64_t)(tw->rejectTime - tw->lastTime));
+    tw->lastTime = tw->rejectTime;
+    tracePutVarint(tw, (uint64_t)tw->rejects);
+    tw->rejects = 0;
+}
+
+// p нужен для TRACE_ENQUEUE; TRACE_REJECT только считается до конца такта
+static void traceEvent(TraceWriter *tw, int kind, int time, int desk, const Passenger *p)
+{
+    if (!tw) return;
+    if (tw->rejects && time != tw->rejectTime) traceFlushRejects(tw);
+    if (kind == TRACE_REJECT) {
+        tw->rejectTime = time;
+        tw->rejects++;
+        return;
+    }
+    if (tw->len + TRACE_RECORD_MAX > TRACE_BUFFER) traceFlush(tw);
+    tw->buf[tw->len++] = (unsigned char)kind;
+    tracePutVarint(tw, (uint64_t)(time - tw->lastTime));
+    tw->lastTime = time;
+    tracePutVarint(tw, (uint64_t)desk);
+    if (p) {
+        size_t idLen = strnlen(p->id, sizeof(p->id));
+        tw->buf[tw->len++] = (unsigned char)idLen;
+        memcpy(tw->buf + tw->len, p->id, idLen);
+        tw->len += idLen;
+    }
+}
+
+// 0 - запись не удалась
+static int traceClose(TraceWriter *tw)
+{
+    traceFlushRejects(tw);
+    traceFlush(tw);
+    if (fclose(tw->f) != 0) tw->failed = 1;
+    free(tw->buf);
+    return !tw->failed;
+}
+
+/*
+ * Параметры прогона и собранные метрики
+ */
+
+typedef struct SimConfig {
+    int desksNum;
+    long long passNum; // < 0 - пассажиры из ввода
+    double load;
+    int maxTs;
+    size_t capacity;
+    int maxTime;
+    int choices;
+    uint64_t seed;
+    int quiet;
+    TraceWriter *trace; // NULL - без трассы
+} SimConfig;
+
+typedef struct SimStats {
+    long long arrived;
+    long long served;
+    long long rejected; // отказов из-за полной очереди (каждый повтор считается)
+    long long events;
+    long long *waitHist; // waitHist[w] - сколько пассажиров ждали w тактов
+    size_t waitCap;
+    double waitSum;
+    int maxQueue;
+    int lastTime;
+    double elapsed;
+} SimStats;
+
+// гистограмма вмещает ожидание wait
+static void reserveWait(SimStats *st, size_t wait)
+{
+    if (wait >= st->waitCap) {
+        size_t cap = st->waitCap ? st->waitCap : 1024;
+        while (cap <= wait) cap *= 2;
+        st->waitHist = realloc(st->waitHist, cap * sizeof(long long));
+        if (!st->waitHist) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+            exit(1);
+        }
+        for (size_t i = st->waitCap; i < cap; i++) st->waitHist[i] = 0;
+        st->waitCap = cap;
+    }
+}
+
+static void recordWait(SimStats *st, int wait)
+{
+    if (wait < 0) wait = 0;
+    reserveWait(st, (size_t)wait);
+    st->waitHist[wait]++;
+    st->waitSum += wait;
+}
+
+// наименьшее w, до которого ждали не меньше доли q обслуженных
+static int waitPercentile(const SimStats *st, double q)
+{
+    long long total = 0;
+    for (size_t i = 0; i < st->waitCap; i++) total += st->waitHist[i];
+    if (total == 0) return 0;
+    long long need = (long long)(q * total);
+    if (need < 1) need = 1;
+    long long seen = 0;
+    for (size_t i = 0; i < st->waitCap; i++) {
+        seen += st->waitHist[i];
+        if (seen >= need) return (int)i;
+    }
+    return (int)st->waitCap - 1;
+}
+
+// пассажир встал первым к стойке в такт start
+static void startService(EventHeap *events, SimStats *st, const Passenger *p, int start, int desk)
+{
+    recordWait(st, start - p->ta);
+    pushDeparture(events, serviceEnd(start, p->ts), desk);
+}
+
+static void printDesks(Queue **desks, int desksNum, int time)
+{
+    printf("Time %d\n", time);
+    puts("-----------------");
+    for (int i = 0; i < desksNum; i++) {
+        printf("#%d ", i + 1);
+        printQueueState(desks[i]);
+        putchar('\n');
+    }
+    putchar('\n');
+}
 
-    // читаем всех пассажиров
-    while (scanf(" %[^/]/%d/%d", p[totPass].id, &p[totPass].ta, &p[totPass].ts) == 3) {
-        totPass++;
-        char isOver;
-        scanf("%c", &isOver);
-        if (isOver == '\n') break;
+/*
+ * Один прогон модели с заданной политикой
+ */
+static void simulate(const SimConfig *cfg, const Policy *policy, SimStats *st)
+{
+    Source src = {0};
+    if (cfg->passNum >= 0) {
+        src.synthetic = 1;
+        src.left = cfg->passNum;
     }
+    // в среднем load * desksNum пассажиров на среднее время обслуживания
+    src.meanGap = (cfg->maxTs + 1) / 2.0 / (cfg->load * cfg->desksNum);
+    src.maxTs = cfg->maxTs;
+    rngSeed(&src.rng, cfg->seed, 1);
+
+    int desksNum = cfg->desksNum;
+    Balancer b;
+    // создаём массив очередей по числу стоек
+    Queue **desks = malloc(desksNum * sizeof(Queue *));
+    if (!desks || !initBalancer(&b, desksNum, cfg->choices, cfg->seed)) {
+        fprintf(stderr, "Ошибка выделения памяти\n");
+        exit(1);
+    }
+    for (int i = 0; i < desksNum; i++) {
+        desks[i] = createQueue(cfg->capacity);
+    }
+
+    EventHeap events = {0};
+    Event next; // следующий ещё не запланированный пассажир из источника
+    int hasNext = nextPassenger(&src, &next.p);
+    int lastTime = 0;
+    double started = nowSec();
 
     /*
-     * цикл по времени
+     * цикл по событиям
      */
-    int currentTime = 0;
-    int maxTime = 100;
-    int isAdded = 0, isDeleted = 0;
-    while (currentTime <= maxTime) {
-        // на текущем шаге времени добавляем всех пассажиров с соотв. ta
-        for (int i = 0; i < totPass; i++) {
-            if (passengers[i].ta == currentTime) {
-                
-                // выбираем стойку для пассажира
-                int idx1 = rand() % desksNum;
-                int idx2;
-                do {
-                    idx2 = rand() % desksNum;
-                } while (idx1 == idx2); 
-
-                if (qSize(desks[idx1]) > qSize(desks[idx2])) {
-                    idx1 = idx2; 
-                }
+    int isChanged = 0;
+    for (;;) {
+        // подкачиваем пассажиров, прибывающих не позже ближайшего события;
+        // ввод упорядочен по ta, опоздавшие в нём прибывают в текущий такт
+        while (hasNext && (events.size == 0 || next.p.ta <= events.items[0].time)) {
+            next.time = next.p.ta > lastTime ? next.p.ta : lastTime;
+            next.kind = EV_ARRIVAL;
+            next.index = src.made - 1;
+            heapPush(&events, &next);
+            hasNext = nextPassenger(&src, &next.p);
+        }
+        if (events.size == 0 || events.items[0].time > cfg->maxTime) break;
 
-                // обработка переполнения
-                if (!isFull(desks[idx1])) {
-                    enqueue(desks[idx1], passengers[i]);
-                    isAdded = 1;
+        Event e;
+        heapPop(&events, &e);
+        int currentTime = lastTime = e.time;
+        st->events++;
+
+        if (e.kind == EV_ARRIVAL) {
+            // выбираем стойку для пассажира
+            int idx = policy->choose(&b);
+
+            // обработка переполнения: пробуем снова в следующий такт
+            if (!isFull(desks[idx])) {
+                enqueue(desks[idx], e.p);
+                traceEvent(cfg->trace, TRACE_ENQUEUE, currentTime, idx, &e.p);
+                updateDesk(&b, idx, 1, e.p.ts);
+                int size = qSize(desks[idx]);
+                if (size > st->maxQueue) st->maxQueue = size;
+                if (size == 1) startService(&events, st, &e.p, currentTime, idx);
+                isChanged = 1;
+            }
+            else {
+                st->rejected++;
+                traceEvent(cfg->trace, TRACE_REJECT, currentTime, idx, NULL);
+                if (currentTime < INT_MAX) {
+                    e.time = currentTime + 1;
+                    heapPush(&events, &e);
                 }
-                else 
-                    passengers[i].ta++;
             }
         }
-
-        // на текущем шаге времени убираем всех пассажиров с соотв. ts
-        for (int i = 0; i < desksNum; i++) {
-            if (!isEmpty(desks[i])) {
-                Passenger *frontP = front(desks[i]);
-                frontP->ts--;
-                if (frontP->ts == 0) {
-                    Passenger temp;
-                    dequeue(desks[i], &temp);
-                    isDeleted = 1;
-                } 
+        else {
+            // первый в очереди обслужен; следующий начинает со следующего такта
+            int desk = (int)e.index;
+            Passenger temp;
+            dequeue(desks[desk], &temp);
+            traceEvent(cfg->trace, TRACE_DEQUEUE, currentTime, desk, NULL);
+            updateDesk(&b, desk, -1, -temp.ts);
+            if (!isEmpty(desks[desk])) {
+                startService(&events, st, front(desks[desk]), currentTime + 1, desk);
             }
+            st->served++;
+            isChanged = 1;
         }
 
-        // на текущей итерации по времени выводим статус стоек при условии его изменения (isAdded или isDeleted)
-        if (isAdded || isDeleted) {       
-            printf("Time %d\n", currentTime);
-            puts("-----------------");
-            for (int i = 0; i < desksNum; i++) {
-                printf("#%d ", i + 1);
-                printQueueState(desks[i]);
-                putchar('\n');
-            }
-            putchar('\n');
-        } 
-        currentTime++;
-        isAdded = 0;
-        isDeleted = 0;
+        // такт закончен - выводим статус стоек при условии его изменения
+        int tickDone = events.size == 0 || events.items[0].time != currentTime;
+        if (hasNext && next.p.ta <= currentTime) tickDone = 0;
+        if (tickDone && isChanged && !cfg->quiet) {
+            printDesks(desks, desksNum, currentTime);
+        }
+        if (tickDone) isChanged = 0;
     }
+    st->elapsed = nowSec() - started;
+    st->arrived = src.made;
+    st->lastTime = lastTime;
 
     // очистка памяти
     for (int i = 0; i < desksNum; i++) {
         destroyQueue(desks[i]);
     }
+    free(desks);
+    freeBalancer(&b);
+    free(events.items);
+}
+
+/*
+ * Многопоточный вариант: стойки поделены на непрерывные куски (шарды),
+ * каждым куском с его очередями и кучей уходов владеет свой поток.
+ * Главный поток - диспетчер: он держит прибытия, выбирает стойку
+ * и передаёт пассажира владельцу через lock-free кольцо.
+ * Время идёт эпохами по одному такту с событиями:
+ *   диспетчер решает прибытия такта t и шлёт каждому шарду метку конца такта;
+ *   шард ставит полученных в очереди, затем обрабатывает свои уходы такта t;
+ *   барьер - и снова главный поток выбирает следующий такт.
+ * Решения принимаются по тем же длинам очередей, что и в однопоточном
+ * прогоне (до уходов такта t), поэтому при одном зерне результат совпадает
+ */
+
+#define CACHE_LINE 64
+#define HANDOFF_SIZE 1024 // степень двойки
+
+typedef struct HandoffItem {
+    Passenger p;
+    int desk; // -1 - метка конца такта
+} HandoffItem;
+
+// кольцо Лэмпорта как в queue_spsc.c, но с номером стойки в каждой записи
+typedef struct Handoff {
+    _Alignas(CACHE_LINE) _Atomic size_t head;
+    size_t cachedTail;
+    _Alignas(CACHE_LINE) _Atomic size_t tail;
+    size_t cachedHead;
+    _Alignas(CACHE_LINE) HandoffItem items[HANDOFF_SIZE];
+} Handoff;
+
+static void handoffPush(Handoff *h, const HandoffItem *item)
+{
+    size_t t = atomic_load_explicit(&h->tail, memory_order_relaxed);
+    while (t - h->cachedHead == HANDOFF_SIZE) {
+        h->cachedHead = atomic_load_explicit(&h->head, memory_order_acquire);
+        if (t - h->cachedHead == HANDOFF_SIZE) sched_yield(); // шард не успевает
+    }
+    h->items[t & (HANDOFF_SIZE - 1)] = *item;
+    atomic_store_explicit(&h->tail, t + 1, memory_order_release);
+}
+
+static void handoffPop(Handoff *h, HandoffItem *item)
+{
+    size_t hd = atomic_load_explicit(&h->head, memory_order_relaxed);
+    while (h->cachedTail == hd) {
+        h->cachedTail = atomic_load_explicit(&h->tail, memory_order_acquire);
+        if (h->cachedTail == hd) sched_yield(); // диспетчер ещё решает
+    }
+    *item = h->items[hd & (HANDOFF_SIZE - 1)];
+    atomic_store_explicit(&h->head, hd + 1, memory_order_release);
+}
+
+typedef struct ShardedSim ShardedSim;
+
+typedef struct Shard {
+    ShardedSim *sim;
+    Handoff *inbox;
+    EventHeap departures; // только уходы со своих стоек
+    SimStats stats;
+    int changed; // за такт были изменения
+    int nextTime; // ближайший уход или INT_MAX, читается после барьера
+    int *departed; // стойки с уходами за такт - для трассы, пишет её главный поток
+    size_t departedLen;
+    size_t departedCap;
+    int thread; // поток создан
+    pthread_t id;
+} Shard;
+
+struct ShardedSim {
+    Queue **desks;
+    Balancer *b;
+    Shard *shards;
+    int shardsNum;
+    int time; // текущий такт, задаёт главный поток до барьера start
+    int finished;
+    int traced;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    // потоки ждут, пока не созданы все: 1 - работать, -1 - выйти
+    pthread_mutex_t gateLock;
+    pthread_cond_t gate;
+    int gateState;
+};
+
+static void shardTick(Shard *sh, int t)
+{
+    ShardedSim *sim = sh->sim;
+    HandoffItem item;
+    sh->changed = 0;
+    sh->departedLen = 0;
+    // сначала прибытия такта - как в однопоточном цикле
+    for (;;) {
+        handoffPop(sh->inbox, &item);
+        if (item.desk < 0) break;
+        Queue *q = sim->desks[item.desk];
+        enqueue(q, item.p);
+        if (qSize(q) == 1) startService(&sh->departures, &sh->stats, &item.p, t, item.desk);
+        sh->changed = 1;
+    }
+    // диспетчер закончил такт, длины своих стоек можно менять
+    while (sh->departures.size > 0 && sh->departures.items[0].time == t) {
+        Event e;
+        heapPop(&sh->departures, &e);
+        int desk = (int)e.index;
+        Passenger temp;
+        dequeue(sim->desks[desk], &temp);
+        updateDesk(sim->b, desk, -1, -temp.ts);
+        if (sim->traced) {
+            if (sh->departedLen == sh->departedCap) {
+                sh->departedCap = sh->departedCap ? sh->departedCap * 2 : 64;
+                sh->departed = realloc(sh->departed, sh->departedCap * sizeof(int));
+                if (!sh->departed) {
+                    fprintf(stderr, "Ошибка выделения памяти\n");
+                    exit(1);
+                }
+            }
+            sh->departed[sh->departedLen++] = desk;
+        }
+        if (!isEmpty(sim->desks[desk])) {
+            startService(&sh->departures, &sh->stats, front(sim->desks[desk]), t + 1, desk);
+        }
+        sh->stats.events++;
+        sh->stats.served++;
+        sh->changed = 1;
+    }
+    sh->nextTime = sh->departures.size > 0 ? sh->departures.items[0].time : INT_MAX;
+}
+
+static void *shardMain(void *arg)
+{
+    Shard *sh = (Shard *)arg;
+    ShardedSim *sim = sh->sim;
+    pthread_mutex_lock(&sim->gateLock);
+    while (sim->gateState == 0) {
+        pthread_cond_wait(&sim->gate, &sim->gateLock);
+    }
+    int run = sim->gateState > 0;
+    pthread_mutex_unlock(&sim->gateLock);
+    if (!run) return NULL;
+    for (;;) {
+        pthread_barrier_wait(&sim->start);
+        if (sim->finished) return NULL;
+        shardTick(sh, sim->time);
+        pthread_barrier_wait(&sim->done);
+    }
+}
+
+/*
+ * Сколько на деле помещается в очередь, созданную с capacity, или 0, если
+ * она не ограничена (список, экстенты, вектор с QUEUE_GROW). Кольца
+ * округляют размер до степени двойки, поэтому очередь заполняется до isFull -
+ * диспетчер не трогает очереди шардов и сверяется с этим числом
+ */
+static size_t queueLimit(size_t capacity)
+{
+    Queue *q = createQueue(capacity);
+    if (!q) return 0;
+    Passenger p = {0};
+    size_t count = 0;
+    // округление вверх меньше чем удваивает размер, у MPMC он не меньше 2
+    while (!isFull(q) && count <= 2 * capacity + 2 && enqueueBatch(q, &p, 1) == 1) {
+        count++;
+    }
+    size_t limit = isFull(q) ? count : 0;
+    destroyQueue(q);
+    return limit;
+}
+
+static void mergeStats(SimStats *to, const SimStats *from)
+{
+    to->served += from->served;
+    to->events += from->events;
+    to->waitSum += from->waitSum;
+    if (from->waitCap > 0) reserveWait(to, from->waitCap - 1);
+    for (size_t i = 0; i < from->waitCap; i++) {
+        to->waitHist[i] += from->waitHist[i];
+    }
+}
+
+static void openGate(ShardedSim *sim, int state)
+{
+    pthread_mutex_lock(&sim->gateLock);
+    sim->gateState = state;
+    pthread_cond_broadcast(&sim->gate);
+    pthread_mutex_unlock(&sim->gateLock);
+}
+
+/*
+ * То же, что simulate, но стойки обслуживают shardsNum потоков.
+ * Возвращает 0, если потоки создать не удалось
+ */
+static int simulateSharded(const SimConfig *cfg, const Policy *policy, int shardsNum, SimStats *st)
+{
+    int desksNum = cfg->desksNum;
+    int perShard = (desksNum + shardsNum - 1) / shardsNum;
+    shardsNum = (desksNum + perShard - 1) / perShard;
+    size_t limit = queueLimit(cfg->capacity);
+
+    Balancer b;
+    ShardedSim sim = {0};
+    sim.desks = malloc(desksNum * sizeof(Queue *));
+    sim.shards = calloc(shardsNum, sizeof(Shard));
+    if (!sim.desks || !sim.shards || !initBalancer(&b, desksNum, cfg->choices, cfg->seed)) {
+        fprintf(stderr, "Ошибка выделения памяти\n");
+        exit(1);
+    }
+    for (int i = 0; i < desksNum; i++) {
+        sim.desks[i] = createQueue(cfg->capacity);
+    }
+    sim.b = &b;
+    sim.shardsNum = shardsNum;
+    sim.traced = cfg->trace != NULL;
+    pthread_barrier_init(&sim.start, NULL, shardsNum + 1);
+    pthread_barrier_init(&sim.done, NULL, shardsNum + 1);
+    pthread_mutex_init(&sim.gateLock, NULL);
+    pthread_cond_init(&sim.gate, NULL);
+
+    int ok = 1;
+    for (int s = 0; s < shardsNum; s++) {
+        Shard *sh = &sim.shards[s];
+        sh->sim = &sim;
+        sh->nextTime = INT_MAX;
+        sh->inbox = aligned_alloc(CACHE_LINE, sizeof(Handoff));
+        if (!sh->inbox) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+            exit(1);
+        }
+        atomic_init(&sh->inbox->head, 0);
+        atomic_init(&sh->inbox->tail, 0);
+        sh->inbox->cachedHead = sh->inbox->cachedTail = 0;
+        if (ok && pthread_create(&sh->id, NULL, shardMain, sh) == 0) sh->thread = 1;
+        else ok = 0;
+    }
+    openGate(&sim, ok ? 1 : -1);
+
+    // источник открываем только теперь: при неудаче ввод достанется simulate
+    Source src = {0};
+    if (cfg->passNum >= 0) {
+        src.synthetic = 1;
+        src.left = cfg->passNum;
+    }
+    src.meanGap = (cfg->maxTs + 1) / 2.0 / (cfg->load * cfg->desksNum);
+    src.maxTs = cfg->maxTs;
+    rngSeed(&src.rng, cfg->seed, 1);
+
+    EventHeap arrivals = {0};
+    Event next;
+    int hasNext = ok && nextPassenger(&src, &next.p);
+    int lastTime = 0;
+    double started = nowSec();
+
+    while (ok) {
+        // ближайший такт: прибытие или уход на любом шарде
+        int t = INT_MAX;
+        for (int s = 0; s < shardsNum; s++) {
+            if (sim.shards[s].nextTime < t) t = sim.shards[s].nextTime;
+        }
+        int depTime = t;
+        while (hasNext && next.p.ta <= (arrivals.size > 0 && arrivals.items[0].time < depTime
+                                        ? arrivals.items[0].time : depTime)) {
+            next.time = next.p.ta > lastTime ? next.p.ta : lastTime;
+            next.kind = EV_ARRIVAL;
+            next.index = src.made - 1;
+            heapPush(&arrivals, &next);
+            hasNext = nextPassenger(&src, &next.p);
+        }
+        if (arrivals.size > 0 && arrivals.items[0].time < t) t = arrivals.items[0].time;
+        if (t > cfg->maxTime || (t == INT_MAX && arrivals.size == 0)) break;
+
+        sim.time = lastTime = t;
+        pthread_barrier_wait(&sim.start);
+
+        int accepted = 0;
+        while (arrivals.size > 0 && arrivals.items[0].time == t) {
+            Event e;
+            heapPop(&arrivals, &e);
+            st->events++;
+            int idx = policy->choose(&b);
+            int size = deskSize(&b, idx);
+            // размер стойки в балансере совпадает с настоящим: уходы такта ещё впереди
+            if (limit == 0 || (size_t)size < limit) {
+                updateDesk(&b, idx, 1, e.p.ts);
+                traceEvent(cfg->trace, TRACE_ENQUEUE, t, idx, &e.p);
+                if (size + 1 > st->maxQueue) st->maxQueue = size + 1;
+                HandoffItem item = {e.p, idx};
+                handoffPush(sim.shards[idx / perShard].inbox, &item);
+                accepted = 1;
+            }
+            else {
+                st->rejected++;
+                traceEvent(cfg->trace, TRACE_REJECT, t, idx, NULL);
+                if (t < INT_MAX) {
+                    e.time = t + 1;
+                    heapPush(&arrivals, &e);
+                }
+            }
+        }
+        HandoffItem endOfTick = {.desk = -1};
+        for (int s = 0; s < shardsNum; s++) {
+            handoffPush(sim.shards[s].inbox, &endOfTick);
+        }
+        pthread_barrier_wait(&sim.done);
+
+        int changed = accepted;
+        for (int s = 0; s < shardsNum; s++) {
+            Shard *sh = &sim.shards[s];
+            changed |= sh->changed;
+            // шарды идут по возрастанию стоек - порядок тот же, что в одном потоке
+            for (size_t i = 0; i < sh->departedLen; i++) {
+                traceEvent(cfg->trace, TRACE_DEQUEUE, t, sh->departed[i], NULL);
+            }
+        }
+        if (changed && !cfg->quiet) printDesks(sim.desks, desksNum, t);
+    }
+    if (ok) {
+        st->elapsed = nowSec() - started;
+        st->arrived = src.made;
+        st->lastTime = lastTime;
+        // останавливаем потоки
+        sim.finished = 1;
+        pthread_barrier_wait(&sim.start);
+    }
+    for (int s = 0; s < shardsNum; s++) {
+        Shard *sh = &sim.shards[s];
+        if (sh->thread) pthread_join(sh->id, NULL);
+        if (ok) mergeStats(st, &sh->stats);
+        free(sh->stats.waitHist);
+        free(sh->departures.items);
+        free(sh->departed);
+        free(sh->inbox);
+    }
+    pthread_barrier_destroy(&sim.start);
+    pthread_barrier_destroy(&sim.done);
+    pthread_mutex_destroy(&sim.gateLock);
+    pthread_cond_destroy(&sim.gate);
+    for (int i = 0; i < desksNum; i++) {
+        destroyQueue(sim.desks[i]);
+    }
+    free(sim.desks);
+    free(sim.shards);
+    freeBalancer(&b);
+    free(arrivals.items);
+    return ok;
+}
+
+static void printStatsHeader(void)
+{
+    printf("%-10s %10s %8s %8s %6s %10s %10s %12s\n",
+           "policy", "wait_mean", "p50", "p99", "max_q", "rejected", "served", "decisions/s");
+}
+
+static void printStatsRow(const char *name, const SimStats *st)
+{
+    long long started = 0; // дождавшиеся обслуживания
+    for (size_t i = 0; i < st->waitCap; i++) started += st->waitHist[i];
+    // каждое событие прибытия - одно решение политики
+    long long decisions = st->events - st->served;
+    printf("%-10s %10.2f %8d %8d %6d %10lld %10lld %12.0f\n",
+           name, started ? st->waitSum / started : 0.0,
+           waitPercentile(st, 0.5), waitPercentile(st, 0.99),
+           st->maxQueue, st->rejected, st->served,
+           st->elapsed > 0 ? decisions / st->elapsed : 0.0);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "использование: %s [параметры] < ввод\n"
+        "  --desks N       число стоек (для синтетической нагрузки, по умолчанию 4)\n"
+        "  --passengers M  сгенерировать M пассажиров вместо чтения ввода\n"
+        "  --load L        загрузка стоек генератором, по умолчанию 0.9\n"
+        "  --service S     наибольшее время обслуживания, по умолчанию 20\n"
+        "  --capacity C    ёмкость очереди у стойки, по умолчанию %d\n"
+        "  --time T        последний моделируемый такт\n"
+        "  --seed X        зерно генератора, по умолчанию 1\n"
+        "  --policy P      p2c, d-choices, jsq, rr, lrw или all (сравнение, только\n"
+        "                  для синтетической нагрузки), по умолчанию p2c\n"
+        "  --choices D     d для d-choices, по умолчанию 3\n"
+        "  --threads K     поделить стойки между K потоками (0 - по числу ядер),\n"
+        "                  результат тот же, что и в одном потоке\n"
+        "  --trace FILE    записать двоичную трассу событий (см. trace.h, replay.c)\n"
+        "  --quiet         не печатать состояние стоек, только метрики\n",
+        name, QUEUE_CAPACITY);
+}
+
+int main(int argc, char **argv) 
+{   
+    SimConfig cfg = {
+        .desksNum = 4,
+        .passNum = -1,
+        .load = 0.9,
+        .maxTs = 20,
+        .capacity = QUEUE_CAPACITY,
+        .maxTime = -1,
+        .choices = 3,
+        .seed = 1,
+        .quiet = 0,
+    };
+    long long maxTime = -1;
+    const char *policyName = "p2c";
+    int threads = 1;
+    const char *tracePath = NULL;
+    TraceWriter trace;
+
+    static const struct option longOpts[] = {
+        {"desks", required_argument, NULL, 'd'},
+        {"passengers", required_argument, NULL, 'n'},
+        {"load", required_argument, NULL, 'l'},
+        {"service", required_argument, NULL, 's'},
+        {"capacity", required_argument, NULL, 'c'},
+        {"time", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 'r'},
+        {"policy", required_argument, NULL, 'p'},
+        {"choices", required_argument, NULL, 'k'},
+        {"threads", required_argument, NULL, 'j'},
+        {"trace", required_argument, NULL, 'o'},
+        {"quiet", no_argument, NULL, 'q'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:n:l:s:c:t:r:p:k:j:o:q", longOpts, NULL)) != -1) {
+        switch (opt) {
+            case 'd': cfg.desksNum = atoi(optarg); break;
+            case 'n': cfg.passNum = atoll(optarg); break;
+            case 'l': cfg.load = atof(optarg); break;
+            case 's': cfg.maxTs = atoi(optarg); break;
+            case 'c': cfg.capacity = (size_t)atoll(optarg); break;
+            case 't': maxTime = atoll(optarg); break;
+            case 'r': cfg.seed = strtoull(optarg, NULL, 0); break;
+            case 'p': policyName = optarg; break;
+            case 'k': cfg.choices = atoi(optarg); break;
+            case 'j': threads = atoi(optarg); break;
+            case 'o': tracePath = optarg; break;
+            case 'q': cfg.quiet = 1; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    int first = -1, last = -1;
+    for (int i = 0; i < POLICIES_NUM; i++) {
+        if (strcmp(policyName, policies[i].name) == 0) first = last = i;
+    }
+    if (strcmp(policyName, "all") == 0) {
+        // поток ввода не перечитать, сравнение только на генераторе
+        if (cfg.passNum < 0 || tracePath) {
+            fprintf(stderr, "--policy all требует --passengers и несовместим с --trace\n");
+            return 1;
+        }
+        first = 0;
+        last = POLICIES_NUM - 1;
+        cfg.quiet = 1;
+    }
+
+    if (cfg.passNum < 0) {
+        // вводим число стоек в аэропорту 
+        if (scanf("%d ", &cfg.desksNum) != 1) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (maxTime < 0) maxTime = INPUT_MAX_TIME;
+    }
+    cfg.maxTime = maxTime < 0 || maxTime > INT_MAX ? INT_MAX : (int)maxTime;
+    if (threads == 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (first < 0 || threads < 1 || cfg.desksNum < 1 || cfg.maxTs < 1 || cfg.capacity < 1
+        || cfg.load <= 0 || cfg.choices < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (tracePath) {
+        if (!traceOpen(&trace, tracePath, cfg.desksNum, cfg.capacity)) {
+            fprintf(stderr, "Не удалось открыть %s\n", tracePath);
+            return 1;
+        }
+        cfg.trace = &trace;
+    }
+
+    if (cfg.quiet) printStatsHeader();
+    for (int i = first; i <= last; i++) {
+        SimStats st = {0};
+        // один и тот же seed - одинаковый поток пассажиров для всех политик
+        if (threads == 1 || !simulateSharded(&cfg, &policies[i], threads, &st)) {
+            simulate(&cfg, &policies[i], &st);
+        }
+        if (cfg.quiet) printStatsRow(policies[i].name, &st);
+        free(st.waitHist);
+    }
+    if (cfg.trace && !traceClose(cfg.trace)) {
+        fprintf(stderr, "Ошибка записи %s\n", tracePath);
+        return 1;
+    }
     
     return 0;
 }
 
 /*
- * gcc -o program main.c queue_vector.c - компиляция и создание program.exe
+ * gcc -pthread -o program main.c queue_vector.c - компиляция и создание program.exe
+ * gcc -pthread -DQUEUE_GROW -o program main.c queue_vector.c - вектор удваивается вместо переполнения:
+ *     isFull всегда 0, отказов нет, --capacity - лишь начальный размер очереди
+ * gcc -pthread -o program main.c queue_list.c - вариант на списке
+ * gcc -pthread -o program main.c queue_extent.c - вариант на экстентах (список блоков по 64 записи)
+ * gcc -pthread -o program main.c queue_spsc.c, queue_mpmc.c - lock-free кольца для многопоточного использования
+ *     (замер скорости очередей - см. queue_bench.c)
+ * ./program --trace trace.bin --quiet - двоичная трасса вместо снимков, снимки потом даёт replay.c
  * ./program - запуск
  */
\ No newline at end of file
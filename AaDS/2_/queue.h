@@ -14,7 +14,15 @@ typedef struct Passenger {
 
 typedef struct Queue Queue;
 
-Queue *createQueue(size_t capacity); // capacity только для вектора 
+/*
+ * queue_spsc.c и queue_mpmc.c допускают одновременную работу потоков
+ * (один производитель и один потребитель или сколько угодно тех и других).
+ * В них enqueueBatch/dequeueBatch не блокируются и с n = 1 служат попыткой
+ * добавить/извлечь; front, queueForEach и printQueueState безопасны
+ * только когда очередь никто не меняет
+ */
+
+Queue *createQueue(size_t capacity); // capacity только для вектора и lock-free колец
 
 void destroyQueue(Queue *q);
 
@@ -22,16 +30,21 @@ void enqueue(Queue *q, Passenger info);
 
 void dequeue(Queue *q, Passenger *info); 
 
+size_t enqueueBatch(Queue *q, const Passenger *items, size_t n); // возвращает число добавленных
+
+size_t dequeueBatch(Queue *q, Passenger *items, size_t n); // возвращает число извлечённых
+
 int isEmpty(Queue *q);
 
 int isFull(Queue *q); 
 
-int qSize(Queue *q);
+int qSize(Queue *q); // O(1) во всех реализациях
 
 Passenger *front(Queue *q); // возвращает информацию о первом элементе очереди
 
-void printQueueState(Queue *q);
+// обход без изменения очереди: visit вызывается для каждого пассажира от головы к хвосту
+void queueForEach(Queue *q, void (*visit)(const Passenger *p, void *ctx), void *ctx);
 
-Queue copyQueue(Queue *q);
+void printQueueState(Queue *q);
 
 #endif // QUEUE_h
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "queue.h"
+
+
+/*
+ * Пропускная способность очереди в операциях (enqueue + dequeue) в секунду.
+ * Без флагов - однопоточный прогон, пригодный для любой реализации;
+ * -DQUEUE_SPSC - один производитель и один потребитель;
+ * -DQUEUE_MPMC - по N производителей и потребителей для N = 1, 2, 4, ... до maxThreads
+ */
+
+#define BENCH_CAPACITY 1024
+
+typedef struct BenchArgs {
+    Queue *q;
+    size_t count; // сколько записей добавить (извлечь)
+    _Atomic size_t *left; // общий остаток для потребителей MPMC
+    long long sum; // контрольная сумма ta извлечённых
+    int ordered; // извлечённые шли строго по порядку
+} BenchArgs;
+
+double nowSec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void *producer(void *arg) {
+    BenchArgs *a = (BenchArgs *)arg;
+    Passenger p;
+    memset(&p, 0, sizeof(Passenger));
+    for (size_t i = 0; i < a->count; i++) {
+        p.ta = (int)i;
+        while (enqueueBatch(a->q, &p, 1) == 0)
+            sched_yield(); // очередь полна - отдаём ядро потребителю
+    }
+    return NULL;
+}
+
+void *consumer(void *arg) {
+    BenchArgs *a = (BenchArgs *)arg;
+    Passenger p;
+    a->sum = 0;
+    a->ordered = 1;
+    for (size_t i = 0; ; i++) {
+        if (a->left) { // MPMC: забираем номер из общего остатка
+            size_t left = atomic_load(a->left);
+            do {
+                if (left == 0) return NULL;
+            } while (!atomic_compare_exchange_weak(a->left, &left, left - 1));
+        } else if (i == a->count)
+            return NULL;
+        while (dequeueBatch(a->q, &p, 1) == 0)
+            sched_yield();
+        if (!a->left && p.ta != (int)i)
+            a->ordered = 0;
+        a->sum += p.ta;
+    }
+}
+
+void singleThreaded(size_t total) {
+    Queue *q = createQueue(BENCH_CAPACITY);
+    Passenger p;
+    memset(&p, 0, sizeof(Passenger));
+    long long sum = 0;
+    double t = nowSec();
+    for (size_t done = 0; done < total; ) { // заполняем наполовину и опустошаем
+        for (int i = 0; i < BENCH_CAPACITY / 2; i++, done++) {
+            p.ta = (int)done;
+            enqueue(q, p);
+        }
+        while (!isEmpty(q)) {
+            dequeue(q, &p);
+            sum += p.ta;
+        }
+    }
+    t = nowSec() - t;
+    printf("%-10s %8d %14.0f ops/s (checksum %lld)\n", "single", 1, 2.0 * total / t, sum);
+    destroyQueue(q);
+}
+
+#if defined(QUEUE_SPSC)
+
+void concurrent(size_t total, int maxThreads) {
+    (void)maxThreads;
+    Queue *q = createQueue(BENCH_CAPACITY);
+    BenchArgs prod = {q, total, NULL, 0, 0}, cons = {q, total, NULL, 0, 0};
+    pthread_t pt, ct;
+    double t = nowSec();
+    pthread_create(&ct, NULL, consumer, &cons);
+    pthread_create(&pt, NULL, producer, &prod);
+    pthread_join(pt, NULL);
+    pthread_join(ct, NULL);
+    t = nowSec() - t;
+    printf("%-10s %8s %14.0f ops/s%s\n", "spsc", "1+1", 2.0 * total / t, cons.ordered ? "" : " ORDER BROKEN");
+    destroyQueue(q);
+}
+
+#elif defined(QUEUE_MPMC)
+
+void concurrent(size_t total, int maxThreads) {
+    for (int n = 1; n <= maxThreads; n *= 2) {
+        Queue *q = createQueue(BENCH_CAPACITY);
+        BenchArgs *args = (BenchArgs *)calloc(2 * n, sizeof(BenchArgs));
+        pthread_t *threads = (pthread_t *)malloc(2 * n * sizeof(pthread_t));
+        _Atomic size_t left;
+        atomic_init(&left, total / n * n);
+        double t = nowSec();
+        for (int i = 0; i < n; i++) {
+            args[i] = (BenchArgs){q, total / n, NULL, 0, 0};
+            args[n + i] = (BenchArgs){q, 0, &left, 0, 0};
+            pthread_create(&threads[n + i], NULL, consumer, &args[n + i]);
+            pthread_create(&threads[i], NULL, producer, &args[i]);
+        }
+        long long sum = 0;
+        for (int i = 0; i < 2 * n; i++) {
+            pthread_join(threads[i], NULL);
+            sum += args[i].sum;
+        }
+        t = nowSec() - t;
+        long long per = (long long)(total / n);
+        long long expected = (long long)n * per * (per - 1) / 2;
+        printf("%-10s %5d+%-2d %14.0f ops/s%s\n", "mpmc", n, n, 2.0 * (total / n * n) / t,
+               sum == expected ? "" : " CHECKSUM MISMATCH");
+        free(threads);
+        free(args);
+        destroyQueue(q);
+    }
+}
+
+#endif
+
+int main(int argc, char **argv) {
+    size_t total = argc > 1 ? (size_t)atol(argv[1]) : 10000000;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 8;
+    printf("%-10s %8s %20s\n", "mode", "threads", "throughput");
+    singleThreaded(total);
+#if defined(QUEUE_SPSC) || defined(QUEUE_MPMC)
+    concurrent(total, maxThreads);
+#else
+    (void)maxThreads;
+#endif
+    return 0;
+}
+
+/*
+ * gcc -O2 -o bench queue_bench.c queue_vector.c - однопоточная база
+ * gcc -O2 -pthread -DQUEUE_SPSC -o bench queue_bench.c queue_spsc.c
+ * gcc -O2 -pthread -DQUEUE_MPMC -o bench queue_bench.c queue_mpmc.c
+ * ./bench [operations [maxThreads]] - по умолчанию 10^7 операций, до 8 потоков на сторону
+ */
@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "queue.h"
+
+
+/*
+ * Очередь на экстентах: односвязный список блоков по EXTENT_SIZE пассажиров.
+ * Внутри блока записи лежат подряд, поэтому обход идёт по памяти линейно,
+ * а выделение памяти происходит раз на блок. Опустевшие блоки не освобождаются,
+ * а складываются в стек запасных и берутся при следующем росте
+ */
+#define EXTENT_SIZE 64
+
+typedef struct Extent {
+    struct Extent *next;
+    Passenger items[EXTENT_SIZE];
+} Extent;
+
+struct Queue {
+    Extent *head, *tail;
+    size_t headPos; // первая занятая позиция в head
+    size_t tailPos; // первая свободная позиция в tail
+    Extent *spare; // стек запасных блоков
+    size_t size;
+};
+
+static Extent *takeExtent(Queue *q) {
+    Extent *ext = q->spare;
+    if (ext)
+        q->spare = ext->next;
+    else {
+        ext = (Extent *)malloc(sizeof(Extent));
+        if (!ext) return NULL;
+    }
+    ext->next = NULL;
+    return ext;
+}
+
+static void recycleExtent(Queue *q, Extent *ext) {
+    ext->next = q->spare;
+    q->spare = ext;
+}
+
+static void freeExtents(Extent *ext) {
+    while (ext) {
+        Extent *next = ext->next;
+        free(ext);
+        ext = next;
+    }
+}
+
+Queue *createQueue(size_t capacity) {
+    (void)capacity; // экстенты растут без ограничения
+    Queue *q = (Queue *)malloc(sizeof(Queue));
+    if (!q) return NULL;
+    q->spare = NULL;
+    q->head = q->tail = takeExtent(q);
+    if (!q->head) {
+        free(q);
+        return NULL;
+    }
+    q->headPos = q->tailPos = 0;
+    q->size = 0;
+    return q;
+}
+
+void destroyQueue(Queue *q) {
+    if (q) {
+        freeExtents(q->head);
+        freeExtents(q->spare);
+        free(q);
+    }
+}
+
+// место под запись в хвосте; при заполненном хвостовом блоке подвешивается новый
+static int reserveTail(Queue *q) {
+    if (q->tailPos < EXTENT_SIZE)
+        return 1;
+    Extent *ext = takeExtent(q);
+    if (!ext) return 0;
+    q->tail->next = ext;
+    q->tail = ext;
+    q->tailPos = 0;
+    return 1;
+}
+
+// голова дошла до конца блока: блок уходит в запас
+static void advanceHead(Queue *q) {
+    if (q->size == 0) { // единственный блок опустел - начинаем его сначала
+        q->headPos = q->tailPos = 0;
+        if (q->head != q->tail) {
+            recycleExtent(q, q->head);
+            q->head = q->tail;
+        }
+        return;
+    }
+    if (q->headPos == EXTENT_SIZE) {
+        Extent *old = q->head;
+        q->head = old->next;
+        q->headPos = 0;
+        recycleExtent(q, old);
+    }
+}
+
+void enqueue(Queue *q, Passenger info) {
+    if (!reserveTail(q)) return;
+    q->tail->items[q->tailPos++] = info;
+    q->size++;
+}
+
+void dequeue(Queue *q, Passenger *info) {
+    if (isEmpty(q)) {
+        puts("Underflow");
+        return;
+    }
+    *info = q->head->items[q->headPos++];
+    q->size--;
+    advanceHead(q);
+}
+
+size_t enqueueBatch(Queue *q, const Passenger *items, size_t n) {
+    size_t done = 0;
+    while (done < n) { // копируем блоками до конца текущего экстента
+        if (!reserveTail(q)) break;
+        size_t part = EXTENT_SIZE - q->tailPos;
+        if (part > n - done)
+            part = n - done;
+        memcpy(q->tail->items + q->tailPos, items + done, part * sizeof(Passenger));
+        q->tailPos += part;
+        q->size += part;
+        done += part;
+    }
+    return done;
+}
+
+size_t dequeueBatch(Queue *q, Passenger *items, size_t n) {
+    size_t done = 0;
+    while (done < n && q->size > 0) {
+        size_t inBlock = (q->head == q->tail ? q->tailPos : EXTENT_SIZE) - q->headPos;
+        size_t part = inBlock < n - done ? inBlock : n - done;
+        memcpy(items + done, q->head->items + q->headPos, part * sizeof(Passenger));
+        q->headPos += part;
+        q->size -= part;
+        done += part;
+        advanceHead(q);
+    }
+    return done;
+}
+
+int isEmpty(Queue *q) {
+    return q->size == 0;
+}
+
+int isFull(Queue *q) {
+    (void)q;
+    return 0; // переполнение невозможно, как и у списка
+}
+
+int qSize(Queue *q) {
+    return (int)q->size;
+}
+
+Passenger *front(Queue *q) {
+    if (isEmpty(q)) return NULL;
+    return &q->head->items[q->headPos];
+}
+
+void queueForEach(Queue *q, void (*visit)(const Passenger *p, void *ctx), void *ctx) {
+    size_t pos = q->headPos;
+    for (Extent *ext = q->head; ext; ext = ext->next, pos = 0) {
+        size_t end = ext == q->tail ? q->tailPos : EXTENT_SIZE;
+        for (; pos < end; pos++)
+            visit(&ext->items[pos], ctx);
+    }
+}
+
+static void printId(const Passenger *p, void *ctx) {
+    (void)ctx;
+    printf("%s ", p->id);
+}
+
+void printQueueState(Queue *q) {
+    queueForEach(q, printId, NULL);
+}
@@ -8,29 +8,77 @@ typedef struct Node {
     struct Node *next;
 } Node;
 
+/*
+ * Узлы берутся из пула очереди: память выделяется блоками по NODES_PER_SLAB
+ * узлов, освобождённые узлы складываются в стек и выдаются первыми
+ * (последний освобождённый ещё в кэше). Блоки освобождаются разом в destroyQueue
+ */
+#define NODES_PER_SLAB 256
+
+typedef struct Slab {
+    struct Slab *next;
+    Node nodes[NODES_PER_SLAB];
+} Slab;
+
 typedef struct Queue {
     Node *head;
     Node *tail;
+    Node *freeNodes; // стек освобождённых узлов, связанный через next
+    Slab *slabs;
+    size_t slabUsed; // сколько узлов верхнего блока уже выдано
+    size_t size; // число записей, чтобы qSize не обходил список
 } Queue;
 
+static Node *allocNode(Queue *q) {
+    if (q->freeNodes) {
+        Node *node = q->freeNodes;
+        q->freeNodes = node->next;
+        return node;
+    }
+    if (!q->slabs || q->slabUsed == NODES_PER_SLAB) {
+        Slab *slab = (Slab *)malloc(sizeof(Slab));
+        if (!slab) return NULL;
+        slab->next = q->slabs;
+        q->slabs = slab;
+        q->slabUsed = 0;
+    }
+    return &q->slabs->nodes[q->slabUsed++];
+}
+
+static void releaseNode(Queue *q, Node *node) {
+    node->next = q->freeNodes;
+    q->freeNodes = node;
+}
+
+static void releasePool(Queue *q) {
+    while (q->slabs) {
+        Slab *next = q->slabs->next;
+        free(q->slabs);
+        q->slabs = next;
+    }
+    q->head = q->tail = q->freeNodes = NULL;
+    q->size = 0;
+}
+
 Queue *createQueue(size_t capacity) {
     (void)capacity;
     Queue *q = (Queue *)malloc(sizeof(Queue));
     if (!q) return NULL;
     q->head = q->tail = NULL;
+    q->freeNodes = NULL;
+    q->slabs = NULL;
+    q->slabUsed = 0;
+    q->size = 0;
     return q;
 }
 
 void destroyQueue(Queue *q) {
-    while (!isEmpty(q)) {
-        Passenger info;
-        dequeue(q, &info); // зачищаем записи о пассажирах при каждом извлечении с free
-    }
+    releasePool(q); // все узлы живут в блоках пула, поштучно ничего не освобождается
     free(q);
 }
 
 void enqueue(Queue *q, Passenger info) {
-    Node *newNode = (Node *)malloc(sizeof(Node));
+    Node *newNode = allocNode(q);
     if (!newNode) return;
     newNode->info = info;
     newNode->next = NULL; // т.к. добавляем в конец
@@ -40,6 +88,7 @@ void enqueue(Queue *q, Passenger info) {
         q->tail->next = newNode; // заносим в текущий узел указатель на новый
         q->tail = newNode; // смещаем указатель на последнего на новый
     }
+    q->size++;
 }
 
 void dequeue(Queue *q, Passenger *info) {
@@ -48,12 +97,30 @@ void dequeue(Queue *q, Passenger *info) {
         return;
     }
     Node *temp = q->head;
-    *info = temp->info; // копируем данные из temp, а потом освобождаем его
+    *info = temp->info; // копируем данные из temp, а потом возвращаем узел в пул
     q->head = temp->next;
     if (q->head == NULL) {
         q->tail = NULL; // Обнуляем tail, если очередь пуста
     }
-    free(temp);
+    releaseNode(q, temp);
+    q->size--;
+}
+
+size_t enqueueBatch(Queue *q, const Passenger *items, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        Node *oldTail = q->tail;
+        enqueue(q, items[i]);
+        if (q->tail == oldTail) // узел не выделился
+            return i;
+    }
+    return n;
+}
+
+size_t dequeueBatch(Queue *q, Passenger *items, size_t n) {
+    size_t i = 0;
+    for (; i < n && !isEmpty(q); i++)
+        dequeue(q, &items[i]);
+    return i;
 }
 
 int isEmpty(Queue *q) {
@@ -66,13 +133,7 @@ int isFull(Queue *q) {
 }
 
 int qSize(Queue *q) {
-    int size = 0;
-    Node *current = q->head;
-    while (current) {
-        size++;
-        current = current->next;
-    }
-    return size;
+    return (int)q->size;
 }
 
 Passenger *front(Queue *q) {
@@ -80,24 +141,16 @@ Passenger *front(Queue *q) {
     return &q->head->info;
 }
 
-void printQueueState(Queue *q) {
-    Queue tempQueue = copyQueue(q); // создаём копию, чтобы не менять оригинальную при выводе
-
-    while (!isEmpty(&tempQueue)) {
-        Passenger p;
-        dequeue(&tempQueue, &p);
-        printf("%s ", p.id);
-    }
-    destroyQueue(&tempQueue); // уничтожаем копию во избежании утечек памяти
+void queueForEach(Queue *q, void (*visit)(const Passenger *p, void *ctx), void *ctx) {
+    for (Node *current = q->head; current; current = current->next)
+        visit(&current->info, ctx);
 }
 
-Queue copyQueue(Queue *q) {
-    Queue newQueue = {NULL, NULL};
-    Node *current = q->head;
+static void printId(const Passenger *p, void *ctx) {
+    (void)ctx;
+    printf("%s ", p->id);
+}
 
-    while (current) {
-        enqueue(&newQueue, current->info);
-        current = current->next;
-    }
-    return newQueue;
+void printQueueState(Queue *q) {
+    queueForEach(q, printId, NULL); // обход по месту, без копии очереди
 }
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "queue.h"
+
+
+/*
+ * Ограниченная MPMC-очередь Вьюкова. У каждой ячейки свой номер seq:
+ * seq == pos - ячейка свободна для записи с номером pos, seq == pos + 1 -
+ * в ней запись pos, готовая к чтению. Производители и потребители
+ * захватывают номера CAS-ом по своему счётчику, ячейки не блокируются.
+ * Размер кольца - capacity, округлённая вверх до степени двойки (не меньше 2)
+ */
+#define CACHE_LINE 64
+
+typedef struct Cell {
+    _Atomic size_t seq;
+    Passenger data;
+} Cell;
+
+struct Queue {
+    _Alignas(CACHE_LINE) Cell *cells;
+    size_t mask;
+    _Alignas(CACHE_LINE) _Atomic size_t enqPos;
+    _Alignas(CACHE_LINE) _Atomic size_t deqPos;
+};
+
+Queue *createQueue(size_t capacity) {
+    Queue *q = (Queue *)aligned_alloc(CACHE_LINE, sizeof(Queue));
+    if (!q) return NULL;
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    q->cells = (Cell *)malloc(size * sizeof(Cell));
+    if (!q->cells) {
+        free(q);
+        return NULL;
+    }
+    for (size_t i = 0; i < size; i++)
+        atomic_init(&q->cells[i].seq, i);
+    q->mask = size - 1;
+    atomic_init(&q->enqPos, 0);
+    atomic_init(&q->deqPos, 0);
+    return q;
+}
+
+void destroyQueue(Queue *q) {
+    if (q) {
+        free(q->cells);
+        free(q);
+    }
+}
+
+static int tryEnqueue(Queue *q, const Passenger *info) {
+    size_t pos = atomic_load_explicit(&q->enqPos, memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->enqPos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return 0; // ячейку ещё не освободили - очередь полна
+        } else {
+            pos = atomic_load_explicit(&q->enqPos, memory_order_relaxed);
+        }
+    }
+    cell->data = *info;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return 1;
+}
+
+static int tryDequeue(Queue *q, Passenger *info) {
+    size_t pos = atomic_load_explicit(&q->deqPos, memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->deqPos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return 0; // запись pos ещё не опубликована - очередь пуста
+        } else {
+            pos = atomic_load_explicit(&q->deqPos, memory_order_relaxed);
+        }
+    }
+    *info = cell->data;
+    atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release); // ячейка свободна для следующего круга
+    return 1;
+}
+
+void enqueue(Queue *q, Passenger info) {
+    if (!tryEnqueue(q, &info))
+        puts("Overflow");
+}
+
+void dequeue(Queue *q, Passenger *info) {
+    if (!tryDequeue(q, info))
+        puts("Underflow");
+}
+
+size_t enqueueBatch(Queue *q, const Passenger *items, size_t n) {
+    size_t i = 0;
+    while (i < n && tryEnqueue(q, &items[i]))
+        i++;
+    return i;
+}
+
+size_t dequeueBatch(Queue *q, Passenger *items, size_t n) {
+    size_t i = 0;
+    while (i < n && tryDequeue(q, &items[i]))
+        i++;
+    return i;
+}
+
+int qSize(Queue *q) {
+    // счётчики читаются не одновременно - при гонке размер лишь приблизителен
+    size_t d = atomic_load_explicit(&q->deqPos, memory_order_acquire);
+    size_t e = atomic_load_explicit(&q->enqPos, memory_order_acquire);
+    return e > d ? (int)(e - d) : 0;
+}
+
+int isEmpty(Queue *q) {
+    return qSize(q) == 0;
+}
+
+int isFull(Queue *q) {
+    return (size_t)qSize(q) > q->mask;
+}
+
+Passenger *front(Queue *q) {
+    if (isEmpty(q)) return NULL;
+    return &q->cells[atomic_load_explicit(&q->deqPos, memory_order_relaxed) & q->mask].data;
+}
+
+void queueForEach(Queue *q, void (*visit)(const Passenger *p, void *ctx), void *ctx) {
+    size_t e = atomic_load_explicit(&q->enqPos, memory_order_acquire);
+    for (size_t i = atomic_load_explicit(&q->deqPos, memory_order_acquire); i != e; i++)
+        visit(&q->cells[i & q->mask].data, ctx);
+}
+
+static void printId(const Passenger *p, void *ctx) {
+    (void)ctx;
+    printf("%s ", p->id);
+}
+
+void printQueueState(Queue *q) {
+    queueForEach(q, printId, NULL);
+}
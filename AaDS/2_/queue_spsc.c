@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "queue.h"
+
+
+/*
+ * Кольцо Лэмпорта для одного производителя и одного потребителя.
+ * head пишет только потребитель, tail - только производитель; каждый держит
+ * у себя копию чужого индекса и перечитывает её, лишь когда кольцо кажется
+ * пустым (полным). Поля разных сторон разнесены по разным строкам кэша
+ */
+#define CACHE_LINE 64
+
+struct Queue {
+    // сторона потребителя
+    _Alignas(CACHE_LINE) _Atomic size_t head;
+    size_t cachedTail;
+    // сторона производителя
+    _Alignas(CACHE_LINE) _Atomic size_t tail;
+    size_t cachedHead;
+    // только для чтения после создания
+    _Alignas(CACHE_LINE) Passenger *data;
+    size_t mask;
+    size_t limit;
+};
+
+Queue *createQueue(size_t capacity) {
+    if (capacity == 0) return NULL;
+    Queue *q = (Queue *)aligned_alloc(CACHE_LINE, sizeof(Queue));
+    if (!q) return NULL;
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    q->data = (Passenger *)malloc(size * sizeof(Passenger));
+    if (!q->data) {
+        free(q);
+        return NULL;
+    }
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->cachedHead = q->cachedTail = 0;
+    q->mask = size - 1;
+    q->limit = capacity;
+    return q;
+}
+
+void destroyQueue(Queue *q) {
+    if (q) {
+        free(q->data);
+        free(q);
+    }
+}
+
+size_t enqueueBatch(Queue *q, const Passenger *items, size_t n) {
+    size_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (t - q->cachedHead + n > q->limit) // места по старой копии мало - уточняем
+        q->cachedHead = atomic_load_explicit(&q->head, memory_order_acquire);
+    size_t space = q->limit - (t - q->cachedHead);
+    if (n > space)
+        n = space;
+    size_t size = q->mask + 1, pos = t & q->mask;
+    size_t first = n < size - pos ? n : size - pos;
+    memcpy(q->data + pos, items, first * sizeof(Passenger));
+    memcpy(q->data, items + first, (n - first) * sizeof(Passenger));
+    atomic_store_explicit(&q->tail, t + n, memory_order_release); // публикуем записи разом
+    return n;
+}
+
+size_t dequeueBatch(Queue *q, Passenger *items, size_t n) {
+    size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (q->cachedTail - h < n)
+        q->cachedTail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    size_t avail = q->cachedTail - h;
+    if (n > avail)
+        n = avail;
+    size_t size = q->mask + 1, pos = h & q->mask;
+    size_t first = n < size - pos ? n : size - pos;
+    memcpy(items, q->data + pos, first * sizeof(Passenger));
+    memcpy(items + first, q->data, (n - first) * sizeof(Passenger));
+    atomic_store_explicit(&q->head, h + n, memory_order_release); // освобождаем места разом
+    return n;
+}
+
+void enqueue(Queue *q, Passenger info) {
+    if (enqueueBatch(q, &info, 1) == 0)
+        puts("Overflow");
+}
+
+void dequeue(Queue *q, Passenger *info) {
+    if (dequeueBatch(q, info, 1) == 0)
+        puts("Underflow");
+}
+
+int isEmpty(Queue *q) {
+    return atomic_load_explicit(&q->head, memory_order_acquire) ==
+           atomic_load_explicit(&q->tail, memory_order_acquire);
+}
+
+int isFull(Queue *q) {
+    return (size_t)qSize(q) >= q->limit;
+}
+
+int qSize(Queue *q) {
+    size_t h = atomic_load_explicit(&q->head, memory_order_acquire);
+    size_t t = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return (int)(t - h);
+}
+
+Passenger *front(Queue *q) { // для потребителя: запись не уйдёт, пока он сам её не извлечёт
+    if (isEmpty(q)) return NULL;
+    return &q->data[atomic_load_explicit(&q->head, memory_order_relaxed) & q->mask];
+}
+
+void queueForEach(Queue *q, void (*visit)(const Passenger *p, void *ctx), void *ctx) {
+    size_t t = atomic_load_explicit(&q->tail, memory_order_acquire);
+    for (size_t i = atomic_load_explicit(&q->head, memory_order_acquire); i != t; i++)
+        visit(&q->data[i & q->mask], ctx);
+}
+
+static void printId(const Passenger *p, void *ctx) {
+    (void)ctx;
+    printf("%s ", p->id);
+}
+
+void printQueueState(Queue *q) {
+    queueForEach(q, printId, NULL);
+}
@@ -1,23 +1,48 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "queue.h"
 
 
+/*
+ * Кольцевой буфер размера 2^k: head и tail - свободно растущие счётчики,
+ * позиция в data получается маской, размер очереди - tail - head.
+ * Вместимость ограничена limit (capacity из createQueue); при сборке
+ * с -DQUEUE_GROW буфер вместо переполнения удваивается, а isFull всегда 0 -
+ * capacity задаёт лишь начальный размер
+ */
 struct Queue {
     Passenger *data;
-    size_t head, tail, capacity;
+    size_t head, tail;
+    size_t mask; // размер data - 1
+    size_t limit;
 };
 
+// заполнен ли буфер до limit (isFull без учёта роста)
+static int atLimit(Queue *q) {
+    return q->tail - q->head == q->limit;
+}
+
+static size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
 Queue *createQueue(size_t capacity) {
+    if (capacity == 0) return NULL;
     Queue *q = (Queue *)malloc(sizeof(Queue));
     if (!q) return NULL;
-    q->data = (Passenger *)malloc(capacity * sizeof(Passenger));
+    size_t size = roundUpPow2(capacity);
+    q->data = (Passenger *)malloc(size * sizeof(Passenger));
     if (!q->data) {
         free(q);
         return NULL;
     }
     q->head = q->tail = 0;
-    q->capacity = capacity;
+    q->mask = size - 1;
+    q->limit = capacity;
     return q;
 }
 
@@ -28,13 +53,42 @@ void destroyQueue(Queue *q) {
     }
 }
 
+#ifdef QUEUE_GROW
+// удвоение с разворотом кольца: содержимое переезжает в начало нового буфера
+static int grow(Queue *q, size_t need) {
+    size_t size = q->mask + 1, newSize = size;
+    while (newSize < need)
+        newSize <<= 1;
+    if (newSize > size) {
+        Passenger *data = (Passenger *)malloc(newSize * sizeof(Passenger));
+        if (!data) return 0;
+        size_t count = q->tail - q->head, h = q->head & q->mask;
+        size_t first = count < size - h ? count : size - h;
+        memcpy(data, q->data + h, first * sizeof(Passenger));
+        memcpy(data + first, q->data, (count - first) * sizeof(Passenger));
+        free(q->data);
+        q->data = data;
+        q->head = 0;
+        q->tail = count;
+        q->mask = newSize - 1;
+    }
+    if (q->limit < newSize)
+        q->limit = newSize;
+    return 1;
+}
+#endif
+
 void enqueue(Queue *q, Passenger info) {
-    if (isFull(q)) {
-        puts("Overflow");
-        return;
+    if (atLimit(q)) {
+#ifdef QUEUE_GROW
+        if (!grow(q, q->limit + 1))
+#endif
+        {
+            puts("Overflow");
+            return;
+        }
     }
-    q->data[q->tail] = info;
-    q->tail = (q->tail + 1) % q->capacity; // зацикливание
+    q->data[q->tail++ & q->mask] = info;
 }
 
 void dequeue(Queue *q, Passenger *info) {
@@ -42,38 +96,70 @@ void dequeue(Queue *q, Passenger *info) {
         puts("Underflow");
         return;
     }
-    *info = q->data[q->head];
-    q->head = (q->head + 1) % q->capacity;
+    *info = q->data[q->head++ & q->mask];
+}
+
+size_t enqueueBatch(Queue *q, const Passenger *items, size_t n) {
+    size_t count = q->tail - q->head;
+#ifdef QUEUE_GROW
+    if (count + n > q->limit)
+        grow(q, count + n);
+#endif
+    if (n > q->limit - count)
+        n = q->limit - count; // не поместившиеся не добавляются
+    // не больше двух копирований: до конца буфера и с его начала
+    size_t size = q->mask + 1, t = q->tail & q->mask;
+    size_t first = n < size - t ? n : size - t;
+    memcpy(q->data + t, items, first * sizeof(Passenger));
+    memcpy(q->data, items + first, (n - first) * sizeof(Passenger));
+    q->tail += n;
+    return n;
+}
+
+size_t dequeueBatch(Queue *q, Passenger *items, size_t n) {
+    size_t count = q->tail - q->head;
+    if (n > count)
+        n = count;
+    size_t size = q->mask + 1, h = q->head & q->mask;
+    size_t first = n < size - h ? n : size - h;
+    memcpy(items, q->data + h, first * sizeof(Passenger));
+    memcpy(items + first, q->data, (n - first) * sizeof(Passenger));
+    q->head += n;
+    return n;
 }
 
 int isEmpty(Queue *q) {
-    return q->head == q->tail; // можно q->size == 0;
+    return q->head == q->tail;
 }
 
 int isFull(Queue *q) {
-    return (q->tail + 1) % q->capacity == q->head;
+#ifdef QUEUE_GROW
+    (void)q;
+    return 0; // место добавит grow
+#else
+    return atLimit(q);
+#endif
 }
 
 int qSize(Queue *q) {
-    if (q->tail >= q->head) {
-        return q->tail - q->head;
-    } else {
-        return q->capacity - (q->head - q->tail);
-    }
+    return (int)(q->tail - q->head);
 }
 
 Passenger *front(Queue *q) {
     if (isEmpty(q)) return NULL;
-    return &q->data[q->head];
+    return &q->data[q->head & q->mask];
 }
 
-void printQueueState(Queue *q) {
-    Queue tempQueue = *q;
+void queueForEach(Queue *q, void (*visit)(const Passenger *p, void *ctx), void *ctx) {
+    for (size_t i = q->head; i != q->tail; i++)
+        visit(&q->data[i & q->mask], ctx);
+}
 
-    while (!isEmpty(&tempQueue)) {
-        Passenger p;
-        Passenger *frontP = front(&tempQueue);
-        printf("%s ", frontP->id);
-        dequeue(&tempQueue, &p);
-    }
+static void printId(const Passenger *p, void *ctx) {
+    (void)ctx;
+    printf("%s ", p->id);
+}
+
+void printQueueState(Queue *q) {
+    queueForEach(q, printId, NULL);
 }
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "queue.h"
+#include "trace.h"
+
+
+/*
+ * Восстановление текстовых снимков "Time N" по двоичной трассе main.c.
+ * Состояние стоек накапливается с начала трассы, а печатаются только
+ * такты из заданного диапазона - вывод тот же, что печатала бы сама модель
+ */
+
+#define READ_BUFFER (1 << 20)
+
+typedef struct TraceReader {
+    FILE *f;
+    unsigned char *buf;
+    size_t pos;
+    size_t len;
+} TraceReader;
+
+// -1 - конец файла
+static int readByte(TraceReader *r)
+{
+    if (r->pos == r->len) {
+        r->len = fread(r->buf, 1, READ_BUFFER, r->f);
+        r->pos = 0;
+        if (r->len == 0) return -1;
+    }
+    return r->buf[r->pos++];
+}
+
+// 0 - трасса оборвалась посреди числа
+static int readVarint(TraceReader *r, uint64_t *x)
+{
+    *x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = readByte(r);
+        if (c < 0) return 0;
+        *x |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return 1;
+    }
+    return 0;
+}
+
+static void printDesks(Queue **desks, int desksNum, long long time)
+{
+    printf("Time %lld\n", time);
+    puts("-----------------");
+    for (int i = 0; i < desksNum; i++) {
+        printf("#%d ", i + 1);
+        printQueueState(desks[i]);
+        putchar('\n');
+    }
+    putchar('\n');
+}
+
+/*
+ * Проигрывает трассу, печатая снимки тактов из [from, to].
+ * Возвращает 0 при повреждённой трассе
+ */
+static int replay(TraceReader *r, long long from, long long to)
+{
+    char magic[TRACE_MAGIC_LEN];
+    for (int i = 0; i < TRACE_MAGIC_LEN; i++) {
+        int c = readByte(r);
+        if (c < 0) return 0;
+        magic[i] = (char)c;
+    }
+    uint64_t desksNum, capacity;
+    if (memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0
+        || !readVarint(r, &desksNum) || !readVarint(r, &capacity)
+        || desksNum == 0 || desksNum > INT_MAX) return 0;
+
+    Queue **desks = malloc(desksNum * sizeof(Queue *));
+    if (!desks) {
+        fprintf(stderr, "Ошибка выделения памяти\n");
+        exit(1);
+    }
+    for (uint64_t i = 0; i < desksNum; i++) {
+        desks[i] = createQueue(capacity);
+    }
+
+    int ok = 1, isChanged = 0;
+    long long time = 0;
+    for (;;) {
+        int kind = readByte(r);
+        uint64_t delta = 0, desk = 0; // у TRACE_REJECT на месте стойки - число отказов
+        if (kind >= 0 && (!readVarint(r, &delta) || !readVarint(r, &desk)
+                          || (kind != TRACE_REJECT && desk >= desksNum))) {
+            ok = 0;
+            break;
+        }
+        // такт закончился - печатаем его, если он менял стойки
+        if ((kind < 0 || delta > 0) && isChanged && time >= from && time <= to) {
+            printDesks(desks, (int)desksNum, time);
+        }
+        if (delta > 0) isChanged = 0;
+        time += (long long)delta;
+        if (kind < 0 || time > to) break;
+
+        if (kind == TRACE_REJECT) {
+            // отказы стоек не меняют - счётчик только пропускаем
+        }
+        else if (kind == TRACE_ENQUEUE) {
+            Passenger p;
+            memset(&p, 0, sizeof(Passenger));
+            int idLen = readByte(r);
+            if (idLen < 0 || (size_t)idLen >= sizeof(p.id)) {
+                ok = 0;
+                break;
+            }
+            for (int i = 0; i < idLen; i++) {
+                int c = readByte(r);
+                if (c < 0) {
+                    ok = 0;
+                    break;
+                }
+                p.id[i] = (char)c;
+            }
+            if (!ok) break;
+            if (isFull(desks[desk])) {
+                ok = 0;
+                break;
+            }
+            enqueue(desks[desk], p);
+            isChanged = 1;
+        }
+        else if (kind == TRACE_DEQUEUE) {
+            if (isEmpty(desks[desk])) {
+                ok = 0;
+                break;
+            }
+            Passenger temp;
+            dequeue(desks[desk], &temp);
+            isChanged = 1;
+        }
+        else {
+            ok = 0;
+            break;
+        }
+    }
+
+    for (uint64_t i = 0; i < desksNum; i++) {
+        destroyQueue(desks[i]);
+    }
+    free(desks);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "использование: %s трасса [с_такта [по_такт]]\n", argv[0]);
+        return 1;
+    }
+    long long from = argc > 2 ? atoll(argv[2]) : 0;
+    long long to = argc > 3 ? atoll(argv[3]) : LLONG_MAX;
+
+    TraceReader r = {0};
+    r.f = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+    r.buf = malloc(READ_BUFFER);
+    if (!r.f || !r.buf) {
+        fprintf(stderr, "Не удалось открыть %s\n", argv[1]);
+        return 1;
+    }
+    int ok = replay(&r, from, to);
+    if (r.f != stdin) fclose(r.f);
+    free(r.buf);
+    if (!ok) {
+        fprintf(stderr, "Трасса %s повреждена\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * gcc -o replay replay.c queue_list.c - компиляция (подходит любая реализация очереди)
+ * ./replay trace.bin [с_такта [по_такт]] - снимки стоек за диапазон тактов ("-" - трасса из stdin)
+ */
@@ -0,0 +1,32 @@
+#ifndef TRACE_h
+#define TRACE_h
+
+
+/*
+ * Двоичная трасса модели стоек (main.c --trace пишет, replay.c читает).
+ *
+ * Заголовок: TRACE_MAGIC (8 байт), затем varint число стоек и ёмкость очереди.
+ * Далее записи подряд:
+ *   байт вида записи,
+ *   varint прирост времени с предыдущей записи (время не убывает),
+ *   для TRACE_ENQUEUE и TRACE_DEQUEUE - varint номер стойки (с нуля),
+ *   для TRACE_ENQUEUE - ещё байт длины id и сам id без нуля,
+ *   для TRACE_REJECT - varint число отказов за такт.
+ * varint - беззнаковое число по 7 бит в байте, младшие вперёд, старший бит
+ * байта означает продолжение. Кого убрал TRACE_DEQUEUE, понятно из порядка
+ * очереди, поэтому id в нём не пишется.
+ * Записи одного такта идут как в модели: сначала прибытия, затем уходы.
+ * Отказы при перегрузке повторяются каждый такт, поэтому вместо записи
+ * на каждый повтор такт получает одну TRACE_REJECT со счётчиком - последней
+ */
+
+#define TRACE_MAGIC "DESKTRC2"
+#define TRACE_MAGIC_LEN 8
+
+enum {
+    TRACE_ENQUEUE = 1, // пассажир встал в очередь стойки
+    TRACE_DEQUEUE = 2, // первый в очереди обслужен
+    TRACE_REJECT = 3 // за такт столько раз выбранная стойка была полна (пассажиры придут в следующий)
+};
+
+#endif // TRACE_h
@@ -2,6 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 #define INVALID_KEY1 ((size_t)-1)
@@ -9,6 +14,16 @@
 #define MAX_KEY2_LEN 8
 #define MAX_NOTE_LEN 128
 #define MAX_INPUT_LEN 128
+#define KS1_LEAF_MAX 15 /* записей в листе ks1: 16 + 15 * 16 = 256 байт */
+#define KS1_LEAF_MIN (KS1_LEAF_MAX / 2)
+#define KS1_INNER_MAX 15 /* разделителей во внутреннем узле: 8 + 15 * 8 + 16 * 8 = 256 байт */
+#define KS1_INNER_MIN (KS1_INNER_MAX / 2)
+#define KS1_MAX_HEIGHT 32 /* при ветвлении от 8 больше не понадобится */
+#define KS1_NODE_ALIGN 64 /* узлы ks1 с начала строки кэша */
+#define KS2_GROUP 16 /* ячеек ks2 в группе - столько байт сравнивает одна SSE2-команда */
+#define KS2_EMPTY 0x00 /* управляющие байты ks2: пустая ячейка (calloc даёт пустую область) */
+#define KS2_DELETED 0x01 /* удалённая (надгробие); у занятой старший бит и 7 бит хэша */
+#define KS2_REHASH_GROUPS 4 /* сколько групп старой области ks2 переносит одна операция */
 
 /* Структура информации в записи Node*/
 typedef struct Info {
@@ -39,22 +54,47 @@ typedef struct KeySpace1 {
     Node1 *node; /* указатель на информацию */
 } KeySpace1;
 
+// Лист B+-дерева: упорядоченные записи ks1
+typedef struct Leaf1 {
+    int count; /* число записей */
+    struct Leaf1 *next; /* следующий по ключам лист */
+    KeySpace1 entries[KS1_LEAF_MAX];
+} Leaf1;
+
+// Внутренний узел: в child[i] ключи из [keys[i - 1], keys[i])
+typedef struct Inner1 {
+    int count; /* число разделителей, потомков на один больше */
+    size_t keys[KS1_INNER_MAX];
+    void *child[KS1_INNER_MAX + 1]; /* Inner1 или Leaf1 на нижнем уровне */
+} Inner1;
+
+typedef struct Tree1 {
+    void *root; /* Leaf1, если height == 0, иначе Inner1 */
+    int height; /* число уровней внутренних узлов */
+    Leaf1 *first; /* самый левый лист - начало обхода по возрастанию */
+} Tree1;
+
 /* Второе пространство ключей */
 
 typedef struct KeySpace2 {
-    char *key; /* ключ элемента */
-    Item *info; /* указатель на информацию */
-    struct KeySpace2 *next; /* указатель на следующий элемент */
+    unsigned char *ctrl; /* управляющие байты: пусто, удалено или 7 бит хэша ключа */
+    Item **info; /* указатели на информацию, ключ элемента - info[i]->key2 */
+    size_t msize; /* число ячеек */
+    size_t used; /* число занятых ячеек */
+    size_t deleted; /* число удалённых ячеек */
 } KeySpace2;
 
 /* Структура таблицы */
 typedef struct Table {
-    KeySpace1 *ks1;	/* указатель на первое пространство ключей */
-    KeySpace2 **ks2; /* указатель на второе пространство ключей */
-    size_t msize1; /* размер области 1-го пространства ключей */
+    Tree1 ks1; /* первое пространство ключей */
+    KeySpace2 *ks2; /* указатель на второе пространство ключей */
+    KeySpace2 *ks2old; /* старая область ks2, пока из неё идёт перенос, иначе NULL */
+    size_t rehashIdx; /* следующая группа ks2old для переноса */
+    size_t msize1; /* число мест под записи во всех листьях ks1 */
     size_t msize2; /* размер области 2-го пространства ключей */
     size_t csize1; /* количество элементов в области 1-го пространства ключей */
-    size_t csize2; /* количество элементов в области 1-го пространства ключей */
+    size_t csize2; /* количество элементов во 2-м пространстве ключей (в обеих областях) */
+    uint64_t seed2; /* зерно хэш-функции ks2 */
 } Table;
 
 void logError(const char *msg) {
@@ -63,91 +103,367 @@ void logError(const char *msg) {
 
 /* Функции для работы с ks1 */
 
-KeySpace1 *initKs1(Table *, size_t);
-size_t findKeyIdxKs1(Table *, size_t);
-KeySpace1 *resizeKs1(Table *, size_t);
+/* ks1 - B+-дерево: записи KeySpace1 лежат упорядоченно в листьях, листья
+ * связаны в список для обхода по возрастанию key1, внутренние узлы хранят
+ * только ключи-разделители. Узел занимает 4 строки кэша (256 байт), все
+ * листья на одной глубине, поэтому поиск, вставка и удаление - O(log n),
+ * а сдвигаются только записи внутри одного узла
+ */
+
+KeySpace1 *initKs1(Table *);
+KeySpace1 *findKeyKs1(Table *, size_t);
+KeySpace1 *firstKeyKs1(Table *);
 KeySpace1 *insertNewKeyKs1(Table *, size_t);
+void removeKeyKs1(Table *, size_t);
 int insertKs1(Table *, size_t, Item *);
 int deleteKeyKs1(Table*, size_t, int);
 
-KeySpace1 *initKs1(Table *table, size_t capacity) {
-    KeySpace1 *keySpace1 = (KeySpace1 *)calloc(capacity, sizeof(KeySpace1));
-    if (!keySpace1) {
+static Leaf1 *allocLeaf1(Table *table) {
+    Leaf1 *leaf = (Leaf1 *)aligned_alloc(KS1_NODE_ALIGN, sizeof(Leaf1));
+    if (leaf) {
+        leaf->count = 0;
+        leaf->next = NULL;
+        table->msize1 += KS1_LEAF_MAX; // ёмкость ks1 - все записи во всех листьях
+    }
+    return leaf;
+}
+
+static void freeLeaf1(Table *table, Leaf1 *leaf) {
+    table->msize1 -= KS1_LEAF_MAX;
+    free(leaf);
+}
+
+static Inner1 *allocInner1(void) {
+    Inner1 *inner = (Inner1 *)aligned_alloc(KS1_NODE_ALIGN, sizeof(Inner1));
+    if (inner) inner->count = 0;
+    return inner;
+}
+
+// пустое дерево из одного листа; возвращает не NULL при успехе
+KeySpace1 *initKs1(Table *table) {
+    table->msize1 = 0;
+    table->csize1 = 0; // после инициализации число элементов 0
+    Leaf1 *leaf = allocLeaf1(table);
+    if (!leaf) {
         printf("KeySpace 1 init error: malloc error (NULL pointer)");
-    } else {
-        table->msize1 = capacity; // автоматически добавляем информацию в table при init
-        table->csize1 = 0; // после инициализации число элементов 0
-    };
-    return keySpace1; // ks1 в table, NULL в случае ошибки
+        return NULL;
+    }
+    table->ks1.root = leaf;
+    table->ks1.height = 0;
+    table->ks1.first = leaf;
+    return leaf->entries;
+}
+
+// номер потомка внутреннего узла, в поддереве которого лежит key1
+static int childIdx1(const Inner1 *inner, size_t key1) {
+    int i = 0;
+    while (i < inner->count && inner->keys[i] <= key1) i++;
+    return i;
 }
 
-// бинарный поиск в просматриваемой упорядоченной таблице
-size_t findKeyIdxKs1(Table *table, size_t key1) {
-    if (!table || !table->ks1 || table->csize1 == 0) {
-        return INVALID_KEY1;
+// первая позиция в листе с ключом >= key1
+static int leafPos1(const Leaf1 *leaf, size_t key1) {
+    int lo = 0, hi = leaf->count;
+    while (lo < hi) {
+        int middle = (lo + hi) / 2;
+        if (leaf->entries[middle].key < key1) lo = middle + 1;
+        else hi = middle;
     }
+    return lo;
+}
 
-    KeySpace1 *keySpace = table->ks1; 
-    size_t start = 0, end = table->csize1 - 1;
+static Leaf1 *findLeaf1(Table *table, size_t key1) {
+    void *node = table->ks1.root;
+    for (int h = table->ks1.height; h > 0; h--) {
+        Inner1 *inner = (Inner1 *)node;
+        node = inner->child[childIdx1(inner, key1)];
+    }
+    return (Leaf1 *)node;
+}
 
-    while (start <= end) {
-        size_t middle = start + (end - start) / 2; // аналогично (start + end) / 2
-        size_t currKey = keySpace[middle].key;
-        if (currKey == key1) {
-            return middle; // *(k + i) -> (k + i) возвращаем указатель (если возвращаем указатель)
-        } else if (currKey > key1) {
-            if (middle == 0) break; // иначе underflow в size_t
-            end = middle - 1;
-        } else {
-            start = middle + 1;
+// спуск от корня к листу; запись по ключу или NULL
+KeySpace1 *findKeyKs1(Table *table, size_t key1) {
+    if (!table || !table->ks1.root || table->csize1 == 0) {
+        return NULL;
+    }
+    Leaf1 *leaf = findLeaf1(table, key1);
+    int pos = leafPos1(leaf, key1);
+    if (pos < leaf->count && leaf->entries[pos].key == key1) {
+        return &leaf->entries[pos];
+    }
+    return NULL; // если ключ не найден
+}
+
+// запись с наименьшим ключом или NULL
+KeySpace1 *firstKeyKs1(Table *table) {
+    Leaf1 *leaf = table->ks1.first;
+    return leaf && leaf->count > 0 ? &leaf->entries[0] : NULL;
+}
+
+static void freeNode1(void *node, int height) {
+    if (height > 0) {
+        Inner1 *inner = (Inner1 *)node;
+        for (int i = 0; i <= inner->count; i++) {
+            freeNode1(inner->child[i], height - 1);
         }
     }
-    return INVALID_KEY1; // если ключ не найден
+    free(node);
 }
 
 // не удаляет item и info
 void freeKs1(Table *table) {
-    for (size_t i = 0; i < table->csize1; i++) { // достаточно csize1 т.к. таблица упорядочена
-        Node1 *currNode = table->ks1[i].node;
-        while (currNode) {
-            Node1 *next = currNode->next;
-            free(currNode);
-            currNode = next;
+    if (!table->ks1.root) return;
+    for (Leaf1 *leaf = table->ks1.first; leaf; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; i++) {
+            Node1 *currNode = leaf->entries[i].node;
+            while (currNode) {
+                Node1 *next = currNode->next;
+                free(currNode);
+                currNode = next;
+            }
         }
     }
-    free(table->ks1); // чистим весь массив структур KeySpace1
+    freeNode1(table->ks1.root, table->ks1.height);
+    table->ks1.root = NULL;
+    table->ks1.first = NULL;
 }
 
-KeySpace1 *resizeKs1(Table *table, size_t newCapacity) {
-    KeySpace1 *newKeySpace1 = (KeySpace1 *)realloc(table->ks1, newCapacity * sizeof(KeySpace1));
-    if (!newKeySpace1) {
-        logError("memory reallocate error (resizeKs1)");
-    } else {
-        table->ks1 = newKeySpace1;
-        table->msize1 = newCapacity;
+// спуск к листу key1 с запоминанием пути: path[k] - узел уровня k от корня, pathIdx[k] - номер потомка
+static Leaf1 *descend1(Table *table, size_t key1, Inner1 **path, int *pathIdx) {
+    void *node = table->ks1.root;
+    for (int k = 0; k < table->ks1.height; k++) {
+        Inner1 *inner = (Inner1 *)node;
+        path[k] = inner;
+        pathIdx[k] = childIdx1(inner, key1);
+        node = inner->child[pathIdx[k]];
     }
-    return newKeySpace1;
+    return (Leaf1 *)node;
+}
+
+// вставка разделителя key1 и правого потомка right после потомка idx (в узле есть место)
+static void innerInsert1(Inner1 *inner, int idx, size_t key1, void *right) {
+    memmove(inner->keys + idx + 1, inner->keys + idx, (inner->count - idx) * sizeof(size_t));
+    memmove(inner->child + idx + 2, inner->child + idx + 1, (inner->count - idx) * sizeof(void *));
+    inner->keys[idx] = key1;
+    inner->child[idx + 1] = right;
+    inner->count++;
 }
 
-// подфункция функции insertKs1
+/* подфункция функции insertKs1: новая пустая запись для key1 (его ещё нет).
+ * Узлы для делений выделяются заранее, поэтому при нехватке памяти
+ * дерево остаётся нетронутым и возвращается NULL
+ */
 KeySpace1 *insertNewKeyKs1(Table *table, size_t key1) {
-    size_t insertIdx = table->csize1; // по умолчанию - в конец 
-    for (size_t i = 0; i < table->csize1; i++) {
-        if (table->ks1[i].key > key1) { // находим первый наибольший 
-            insertIdx = i;
-            break;
+    Inner1 *path[KS1_MAX_HEIGHT];
+    int pathIdx[KS1_MAX_HEIGHT];
+    int height = table->ks1.height;
+    Leaf1 *leaf = descend1(table, key1, path, pathIdx);
+
+    // делиться будут полный лист и полные узлы над ним подряд, плюс новый корень
+    Leaf1 *spareLeaf = NULL;
+    Inner1 *spareInner[KS1_MAX_HEIGHT + 1];
+    int needInner = 0;
+    if (leaf->count == KS1_LEAF_MAX) {
+        int k = height - 1;
+        while (k >= 0 && path[k]->count == KS1_INNER_MAX) k--;
+        needInner = height - 1 - k + (k < 0); // k < 0 - делится и корень
+        if (height + 1 > KS1_MAX_HEIGHT) {
+            logError("ks1 tree is too high");
+            return NULL;
+        }
+        int ok = (spareLeaf = allocLeaf1(table)) != NULL;
+        for (int i = 0; ok && i < needInner; i++) {
+            ok = (spareInner[i] = allocInner1()) != NULL;
+            if (!ok) needInner = i;
+        }
+        if (!ok) {
+            if (spareLeaf) freeLeaf1(table, spareLeaf);
+            for (int i = 0; i < needInner; i++) free(spareInner[i]);
+            logError("memory allocate error (insertNewKeyKs1)");
+            return NULL;
+        }
+    }
+
+    int pos = leafPos1(leaf, key1);
+    void *right = NULL;
+    size_t splitKey = 0;
+    if (spareLeaf) { // лист полон: половина записей уходит в новый правый лист
+        int half = (KS1_LEAF_MAX + 1) / 2;
+        int moveFrom = pos < half ? half - 1 : half; // новая запись окажется в левом, если pos < half
+        spareLeaf->count = leaf->count - moveFrom;
+        memcpy(spareLeaf->entries, leaf->entries + moveFrom, spareLeaf->count * sizeof(KeySpace1));
+        leaf->count = moveFrom;
+        spareLeaf->next = leaf->next;
+        leaf->next = spareLeaf;
+        right = spareLeaf;
+        if (pos >= half) {
+            pos -= moveFrom;
+            leaf = spareLeaf;
         }
     }
     // смещаем вперёд для освобождения индекса для вставки
-    for (size_t i = table->csize1; i > insertIdx; i--) {
-        table->ks1[i] = table->ks1[i - 1];
+    memmove(leaf->entries + pos + 1, leaf->entries + pos, (leaf->count - pos) * sizeof(KeySpace1));
+    leaf->count++;
+    KeySpace1 *newEntry = &leaf->entries[pos];
+    newEntry->key = key1; // приписываем новый ключ после вставки
+    newEntry->node = NULL;
+    if (right) splitKey = ((Leaf1 *)right)->entries[0].key;
+
+    // поднимаем деления вверх по пути
+    int used = 0;
+    for (int k = height - 1; k >= 0 && right; k--) {
+        Inner1 *inner = path[k];
+        int idx = pathIdx[k];
+        if (inner->count < KS1_INNER_MAX) {
+            innerInsert1(inner, idx, splitKey, right);
+            right = NULL;
+            break;
+        }
+        // узел полон: левая половина остаётся, средний ключ уходит выше
+        Inner1 *newInner = spareInner[used++];
+        int leftCount = (KS1_INNER_MAX + 1) / 2;
+        size_t upKey;
+        if (idx < leftCount) {
+            upKey = inner->keys[leftCount - 1];
+            newInner->count = inner->count - leftCount;
+            memcpy(newInner->keys, inner->keys + leftCount, newInner->count * sizeof(size_t));
+            memcpy(newInner->child, inner->child + leftCount, (newInner->count + 1) * sizeof(void *));
+            inner->count = leftCount - 1;
+            innerInsert1(inner, idx, splitKey, right);
+        } else if (idx > leftCount) {
+            upKey = inner->keys[leftCount];
+            newInner->count = inner->count - leftCount - 1;
+            memcpy(newInner->keys, inner->keys + leftCount + 1, newInner->count * sizeof(size_t));
+            memcpy(newInner->child, inner->child + leftCount + 1, (newInner->count + 1) * sizeof(void *));
+            inner->count = leftCount;
+            innerInsert1(newInner, idx - leftCount - 1, splitKey, right);
+        } else { // новый разделитель сам оказывается средним
+            upKey = splitKey;
+            newInner->count = inner->count - leftCount;
+            memcpy(newInner->keys, inner->keys + leftCount, newInner->count * sizeof(size_t));
+            newInner->child[0] = right;
+            memcpy(newInner->child + 1, inner->child + leftCount + 1, newInner->count * sizeof(void *));
+            inner->count = leftCount;
+        }
+        splitKey = upKey;
+        right = newInner;
+    }
+    if (right) { // поделился корень - дерево растёт на уровень
+        Inner1 *root = spareInner[used++];
+        root->count = 1;
+        root->keys[0] = splitKey;
+        root->child[0] = table->ks1.root;
+        root->child[1] = right;
+        table->ks1.root = root;
+        table->ks1.height++;
     }
     table->csize1++;
-    KeySpace1 *newEntry = &table->ks1[insertIdx];
-    newEntry->key = key1; // приписываем новый ключ после вставки
     return newEntry;
 }
 
+/* удаление записи key1 из дерева (Node1 не трогает).
+ * Узел, где осталось меньше половины, занимает запись у соседа
+ * или сливается с ним; опустевший внутренний корень убирается
+ */
+void removeKeyKs1(Table *table, size_t key1) {
+    Inner1 *path[KS1_MAX_HEIGHT];
+    int pathIdx[KS1_MAX_HEIGHT];
+    Leaf1 *leaf = descend1(table, key1, path, pathIdx);
+    int pos = leafPos1(leaf, key1);
+    if (pos == leaf->count || leaf->entries[pos].key != key1) return;
+    memmove(leaf->entries + pos, leaf->entries + pos + 1, (leaf->count - pos - 1) * sizeof(KeySpace1));
+    leaf->count--;
+    table->csize1--;
+
+    int k = table->ks1.height - 1;
+    if (k >= 0 && leaf->count < KS1_LEAF_MIN) {
+        Inner1 *parent = path[k];
+        int idx = pathIdx[k];
+        Leaf1 *left = idx > 0 ? (Leaf1 *)parent->child[idx - 1] : NULL;
+        Leaf1 *right = idx < parent->count ? (Leaf1 *)parent->child[idx + 1] : NULL;
+        if (left && left->count > KS1_LEAF_MIN) { // берём последнюю запись левого
+            memmove(leaf->entries + 1, leaf->entries, leaf->count * sizeof(KeySpace1));
+            leaf->entries[0] = left->entries[--left->count];
+            leaf->count++;
+            parent->keys[idx - 1] = leaf->entries[0].key;
+            return;
+        }
+        if (right && right->count > KS1_LEAF_MIN) { // берём первую запись правого
+            leaf->entries[leaf->count++] = right->entries[0];
+            memmove(right->entries, right->entries + 1, (right->count - 1) * sizeof(KeySpace1));
+            right->count--;
+            parent->keys[idx] = right->entries[0].key;
+            return;
+        }
+        // сливаем с соседом: правый из пары дописывается в левый
+        if (!left) {
+            left = leaf;
+            idx++;
+        } else {
+            right = leaf;
+        }
+        memcpy(left->entries + left->count, right->entries, right->count * sizeof(KeySpace1));
+        left->count += right->count;
+        left->next = right->next;
+        freeLeaf1(table, right);
+        // из родителя уходят разделитель idx - 1 и потомок idx
+        memmove(parent->keys + idx - 1, parent->keys + idx, (parent->count - idx) * sizeof(size_t));
+        memmove(parent->child + idx, parent->child + idx + 1, (parent->count - idx) * sizeof(void *));
+        parent->count--;
+
+        // то же для внутренних узлов выше
+        for (k--; k >= 0 && parent->count < KS1_INNER_MIN; k--) {
+            Inner1 *node = parent;
+            parent = path[k];
+            idx = pathIdx[k];
+            Inner1 *leftInner = idx > 0 ? (Inner1 *)parent->child[idx - 1] : NULL;
+            Inner1 *rightInner = idx < parent->count ? (Inner1 *)parent->child[idx + 1] : NULL;
+            if (leftInner && leftInner->count > KS1_INNER_MIN) {
+                memmove(node->keys + 1, node->keys, node->count * sizeof(size_t));
+                memmove(node->child + 1, node->child, (node->count + 1) * sizeof(void *));
+                node->keys[0] = parent->keys[idx - 1];
+                node->child[0] = leftInner->child[leftInner->count];
+                parent->keys[idx - 1] = leftInner->keys[leftInner->count - 1];
+                leftInner->count--;
+                node->count++;
+                return;
+            }
+            if (rightInner && rightInner->count > KS1_INNER_MIN) {
+                node->keys[node->count] = parent->keys[idx];
+                node->child[node->count + 1] = rightInner->child[0];
+                node->count++;
+                parent->keys[idx] = rightInner->keys[0];
+                memmove(rightInner->keys, rightInner->keys + 1, (rightInner->count - 1) * sizeof(size_t));
+                memmove(rightInner->child, rightInner->child + 1, rightInner->count * sizeof(void *));
+                rightInner->count--;
+                return;
+            }
+            if (!leftInner) {
+                leftInner = node;
+                idx++;
+            } else {
+                rightInner = node;
+            }
+            // разделитель из родителя спускается между половинами
+            leftInner->keys[leftInner->count] = parent->keys[idx - 1];
+            memcpy(leftInner->keys + leftInner->count + 1, rightInner->keys, rightInner->count * sizeof(size_t));
+            memcpy(leftInner->child + leftInner->count + 1, rightInner->child, (rightInner->count + 1) * sizeof(void *));
+            leftInner->count += rightInner->count + 1;
+            free(rightInner);
+            memmove(parent->keys + idx - 1, parent->keys + idx, (parent->count - idx) * sizeof(size_t));
+            memmove(parent->child + idx, parent->child + idx + 1, (parent->count - idx) * sizeof(void *));
+            parent->count--;
+        }
+    }
+    // у корня остался один потомок - он и становится корнем
+    while (table->ks1.height > 0 && ((Inner1 *)table->ks1.root)->count == 0) {
+        Inner1 *root = (Inner1 *)table->ks1.root;
+        table->ks1.root = root->child[0];
+        table->ks1.height--;
+        free(root);
+    }
+}
+
 int insertKs1(Table *table, size_t key1, Item *item) {
 
     // создаём новую запись
@@ -161,9 +477,8 @@ int insertKs1(Table *table, size_t key1, Item *item) {
     newNode->next = NULL;
 
     // ищем, есть ли элемент с таким ключом
-    size_t foundIdx = findKeyIdxKs1(table, key1);
-    if (foundIdx != INVALID_IDX) { // если элемент с таким ключом уже есть
-        KeySpace1 *found = &table->ks1[foundIdx];
+    KeySpace1 *found = findKeyKs1(table, key1);
+    if (found) { // если элемент с таким ключом уже есть
         Node1 *node = found->node;
         if (node) { // если уже есть запись
             while (node->next) 
@@ -175,14 +490,12 @@ int insertKs1(Table *table, size_t key1, Item *item) {
             found->node = newNode;
         }
     } else { // если элемента с таким ключом нет
-        if (table->csize1 + 1 >= table->msize1) { // если ks1 полон 
-            KeySpace1 *KeySpace = resizeKs1(table, 2 * table->msize1);
-            if (!KeySpace) {
-                logError("memory reallocate error (insertKs1, resizeKs1 section)");
-                return -1;
-            }
-        } // если есть пустые ячейки в ks1 
         KeySpace1 *newKsElem = insertNewKeyKs1(table, key1);
+        if (!newKsElem) {
+            logError("memory allocate error (insertKs1, insertNewKeyKs1 section)");
+            free(newNode);
+            return -1;
+        }
         newKsElem->node = newNode;
     }
     newNode->info->release = newNode->release; // добавляем информацию о release в item
@@ -193,12 +506,11 @@ int insertKs1(Table *table, size_t key1, Item *item) {
  * логика удаления item будет в главной функции delete для table
  */
 int deleteKeyKs1(Table *table, size_t key1, int allReleases) {
-    size_t idxToDelete = findKeyIdxKs1(table, key1);
-    if (idxToDelete == INVALID_IDX) {
+    KeySpace1 *keyToDelete = findKeyKs1(table, key1);
+    if (!keyToDelete) {
         logError("delete error, key not found (ks1)");
         return -1;
     }
-    KeySpace1 *keyToDelete = &table->ks1[idxToDelete];
     Node1 *nodeToDelete = keyToDelete->node;
     if (allReleases) {
         while (nodeToDelete) { // удаляем все версии
@@ -206,20 +518,10 @@ int deleteKeyKs1(Table *table, size_t key1, int allReleases) {
             free(nodeToDelete);
             nodeToDelete = next;
         }
-        for (size_t i = idxToDelete; i < table->csize1 - 1; i++) {
-            table->ks1[i] = table->ks1[i + 1];
-        }
-        table->csize1--;
+        removeKeyKs1(table, key1);
         printf("Key %u successfully deleted from ks1\n", key1);
-        // можно уменьшать ks1 по необходимости (minsize1 = 16)
-        if (table->csize1 < table->msize1 / 2 && table->msize1 >= 32) {
-            KeySpace1 *KeySpace = resizeKs1(table, table->msize1 / 2);
-            if (!KeySpace) {
-                logError("resize error (after key delete)");
-            }
-        }
     } else { // удаляем только последнюю версию (rollback)
-        if (!nodeToDelete->next) { // один релиз = полное удаление
+        if (!nodeToDelete || !nodeToDelete->next) { // один релиз = полное удаление
             return deleteKeyKs1(table, key1, 1);
         } 
         // иначе находим и удаляем последний Node1
@@ -239,204 +541,328 @@ int deleteKeyKs1(Table *table, size_t key1, int allReleases) {
 
 /* Функции для работы с ks2 */
 
-KeySpace2 **initKs2(Table *, size_t);
-size_t hashFunction(Table *, const char *);
-size_t findKeyIdxKs2(Table *, const char *);
+/* ks2 - открытая адресация в духе SwissTable:
+ * ячейки разбиты на группы по KS2_GROUP, у каждой ячейки управляющий байт
+ * (пусто, удалено или младшие 7 бит хэша ключа) и указатель на item.
+ * Поиск берёт группу целиком и одной SIMD-командой сравнивает все
+ * управляющие байты с фрагментом хэша, строки сравниваются только у совпавших.
+ * Группы перебираются с шагом 1, 2, 3, ... (по степени двойки это обходит все),
+ * поиск останавливается на первой группе, где есть пустая ячейка.
+ *
+ * Размер меняется постепенно, как в Redis: resizeKs2 только заводит новую
+ * область, старая остаётся в ks2old, и каждая операция с ks2 переносит
+ * из неё не больше KS2_REHASH_GROUPS групп. Пока перенос идёт, поиск
+ * смотрит в обе области, а новые ключи попадают только в новую
+ */
+
+KeySpace2 *initKs2(Table *, size_t);
+uint64_t hashFunction(Table *, const char *);
+size_t findKeyIdxKs2(Table *, const char *, KeySpace2 **);
 void freeKs2 (Table *);
-KeySpace2 **resizeKs2(Table *, size_t);
-KeySpace2 *createNewKeyKs2(const char *);
+KeySpace2 *resizeKs2(Table *, size_t);
+void rehashStepKs2(Table *, size_t);
 int insertKs2(Table *, const char *, Item *);
 int deleteKeyKs2(Table *, const char *);
 
-KeySpace2 **initKs2(Table *table, size_t capacity) {
-    // инициируем нулями указатели в массиве
-    KeySpace2 **keySpace2 = (KeySpace2 **)calloc(capacity, sizeof(KeySpace2 *));
+// размер области - степень двойки, не меньше группы
+static size_t ks2Capacity(size_t capacity) {
+    size_t size = KS2_GROUP;
+    while (size < capacity) size <<= 1;
+    return size;
+}
+
+// пустые области без записи в table
+static KeySpace2 *allocKs2(size_t capacity) {
+    KeySpace2 *keySpace2 = (KeySpace2 *)malloc(sizeof(KeySpace2));
+    if (!keySpace2) return NULL;
+    // calloc большой области берёт у системы уже нулевые страницы - без
+    // memset на весь размер, иначе начало переноса стоило бы O(n)
+    keySpace2->ctrl = (unsigned char *)calloc(capacity, 1);
+    keySpace2->info = (Item **)malloc(capacity * sizeof(Item *));
+    if (!keySpace2->ctrl || !keySpace2->info) {
+        free(keySpace2->ctrl);
+        free(keySpace2->info);
+        free(keySpace2);
+        return NULL;
+    }
+    keySpace2->msize = capacity;
+    keySpace2->used = 0;
+    keySpace2->deleted = 0;
+    return keySpace2;
+}
+
+static void releaseKs2(KeySpace2 *keySpace2) {
+    if (!keySpace2) return;
+    free(keySpace2->ctrl);
+    free(keySpace2->info);
+    free(keySpace2);
+}
+
+KeySpace2 *initKs2(Table *table, size_t capacity) {
+    capacity = ks2Capacity(capacity);
+    KeySpace2 *keySpace2 = allocKs2(capacity);
     if (!keySpace2) {
-        logError("KeySpace 2 init error: calloc error (NULL pointer)");
+        logError("KeySpace 2 init error: malloc error (NULL pointer)");
     } else {
         table->msize2 = capacity; // автоматически добавляем информацию в table при init
         table->csize2 = 0; // после инициализации число элементов 0
     };
-    return keySpace2; // ks1 в table, NULL в случае ошибки
+    return keySpace2; // ks2 в table, NULL в случае ошибки
 }
 
-size_t hashFunction(Table *table, const char *key2) {
-    size_t hash = 0;
-    while (*key2) {
-        hash ^= (unsigned char)(*key2++);
-    }
-    return hash % table->msize2; // при resize нужно делать rehash
+/* wyhash: 64-битные чтения и умножение 64x64 -> 128 со сверткой половин,
+ * seed у каждой таблицы свой - подобрать коллизии заранее нельзя
+ */
+#define WY_P0 0xa0761d6478bd642full
+#define WY_P1 0xe7037ed1a0b428dbull
+
+static uint64_t wyMix(uint64_t a, uint64_t b) {
+    unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
 }
 
-// сложность O(1); фактически дублирует хеш-функцию
-size_t findKeyIdxKs2(Table *table, const char *key2) {
-    size_t idx = hashFunction(table, key2); // находим по хэшу индекс
-    return idx; // указатель по индексу может быть на NULL
+static uint64_t wyRead8(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
 }
 
-// полная очистка ks2 (нужна в том числе для удаления временной таблицы в resize)
-// не удаляет item и info
-void freeKs2 (Table *table) {
-    for (size_t i = 0; i < table->msize2; i++) {
-        KeySpace2 *chain = table->ks2[i];
-        while (chain) {
-            KeySpace2 *next = chain->next;
-            free(chain);
-            chain = next;
+static uint64_t wyRead4(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t wyhash(const void *key, size_t len, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t a, b;
+    seed ^= wyMix(seed ^ WY_P0, WY_P1);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t shift = (len >> 3) << 2;
+            a = (wyRead4(p) << 32) | wyRead4(p + shift);
+            b = (wyRead4(p + len - 4) << 32) | wyRead4(p + len - 4 - shift);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        while (i > 16) {
+            seed = wyMix(wyRead8(p) ^ WY_P1, wyRead8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
         }
+        a = wyRead8(p + i - 16);
+        b = wyRead8(p + i - 8);
     }
-    free(table->ks2);
+    a ^= WY_P1;
+    b ^= seed;
+    unsigned __int128 r = (unsigned __int128)a * b;
+    a = (uint64_t)r;
+    b = (uint64_t)(r >> 64);
+    return wyMix(a ^ WY_P0 ^ len, b ^ WY_P1);
 }
 
-/* логика такая: коллизии разрешаем сцеплением, сцепления -> списки
- * списки - это плохо, потому что поиск переходит от O(1) к O(N) при увеличении csize/msize
- * при вставке или удалении добавляем условие на поддержание оптимальной заполненности
- * при которой будет не слишком большое число коллизий 
- * 
- * в начале static флаг на защиту от рекурсивного вызова через insertKs2 и deleteKeyKs2
-*/
-KeySpace2 **resizeKs2(Table *table, size_t newCapacity) {
-    static int inResize = 0;
-    if (inResize) {
-        printf("Warning: recursive resizeKs2 call prevented\n");
-        return NULL;
+// младшие 7 бит идут в управляющий байт занятой ячейки, остальные выбирают группу
+uint64_t hashFunction(Table *table, const char *key2) {
+    return wyhash(key2, strlen(key2), table->seed2);
+}
+
+// битовая маска ячеек группы, чей управляющий байт равен value
+static unsigned matchGroup(const unsigned char *group, unsigned char value) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < KS2_GROUP; i++) {
+        if (group[i] == value) mask |= 1u << i;
     }
+    return mask;
+#endif
+}
 
-    inResize = 1; // защита от повторного входа
-    // init НЕ перезаписывает сразу ks2 -> безопасно на случай промежуточных ошибок
-    KeySpace2 **oldKeySpace = table->ks2; 
-    Table *tempTable = (Table *)calloc(1, sizeof(Table)); // временная таблица для обеспечения атомарности
-    KeySpace2 **newKeySpace = initKs2(tempTable, newCapacity); 
-    tempTable->ks2 = newKeySpace; // для работы insert
-    if (!newKeySpace) {
-        logError("memory reallocate error (resizeKs2)");
-        inResize = 0;
-        return NULL;
-    } 
+// свободные ячейки (пустые и удалённые) - у них старший бит управляющего байта сброшен
+static unsigned matchFree(const unsigned char *group) {
+#ifdef __SSE2__
+    return ~(unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group)) & 0xFFFF;
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < KS2_GROUP; i++) {
+        if (!(group[i] & 0x80)) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
 
-    // перехешируем старую таблицу в новую из-за изменения размеров
-    for (size_t i = 0; i < table->msize2; i++) {
-        KeySpace2 *chain = oldKeySpace[i];
-        while (chain) { // бежим по цепочке, если есть
-            int insertRes = insertKs2(tempTable, chain->key, chain->info); // insert в временную копию
-            if (insertRes == -1) { // ошибка любой вставки - выход
-                logError("insert error during resizing");
-                freeKs2(tempTable); // удаляем всё, что выделили для tempTable
-                free(tempTable); // удаляем саму tempTable
-                inResize = 0;
-                return NULL;
-            }
-            chain = chain->next;
+static size_t ks2Find(const KeySpace2 *keySpace2, uint64_t hash, const char *key2) {
+    size_t groupMask = keySpace2->msize / KS2_GROUP - 1;
+    size_t group = (size_t)(hash >> 7) & groupMask;
+    unsigned char h2 = (unsigned char)(0x80 | (hash & 0x7F));
+    for (size_t step = 1; step <= groupMask + 1; step++) {
+        const unsigned char *ctrl = keySpace2->ctrl + group * KS2_GROUP;
+        for (unsigned m = matchGroup(ctrl, h2); m; m &= m - 1) {
+            size_t idx = group * KS2_GROUP + (size_t)__builtin_ctz(m);
+            if (!strcmp(keySpace2->info[idx]->key2, key2)) return idx;
         }
+        if (matchGroup(ctrl, KS2_EMPTY)) break; // дальше ключ уйти не мог
+        group = (group + step) & groupMask;
     }
-    
-    freeKs2(table); // освобождаем записи в старом пространстве
-
-    table->ks2 = tempTable->ks2;
-    table->csize2 = tempTable->csize2;
-    table->msize2 = tempTable->msize2;
+    return INVALID_IDX;
+}
 
-    free(tempTable); // больше не нужна, но записи из неё теперь в ks2 основной table
+// первая свободная ячейка на пути ключа (ключа в области нет)
+static size_t ks2FreeSlot(const KeySpace2 *keySpace2, uint64_t hash) {
+    size_t groupMask = keySpace2->msize / KS2_GROUP - 1;
+    size_t group = (size_t)(hash >> 7) & groupMask;
+    for (size_t step = 1; ; step++) {
+        unsigned m = matchFree(keySpace2->ctrl + group * KS2_GROUP);
+        if (m) return group * KS2_GROUP + (size_t)__builtin_ctz(m);
+        group = (group + step) & groupMask;
+    }
+}
 
-    inResize = 0; // Снимаем блокировку
-    return newKeySpace;
+static void ks2Place(KeySpace2 *keySpace2, uint64_t hash, Item *item) {
+    size_t idx = ks2FreeSlot(keySpace2, hash);
+    if (keySpace2->ctrl[idx] == KS2_DELETED) keySpace2->deleted--;
+    keySpace2->ctrl[idx] = (unsigned char)(0x80 | (hash & 0x7F));
+    keySpace2->info[idx] = item;
+    keySpace2->used++;
 }
 
-// подфункция функции insertKs2
-KeySpace2 *createNewKeyKs2(const char *key2) {
-    KeySpace2 *newKey = (KeySpace2 *)malloc(sizeof(KeySpace2));
-    if (!newKey) {
-        logError("memory allocate error (createNewKeyKs2)");
+static void ks2Remove(KeySpace2 *keySpace2, size_t idx) {
+    const unsigned char *group = keySpace2->ctrl + idx / KS2_GROUP * KS2_GROUP;
+    // если в группе есть пустая ячейка, поиск через неё не проходил - надгробие не нужно
+    if (matchGroup(group, KS2_EMPTY)) {
+        keySpace2->ctrl[idx] = KS2_EMPTY;
     } else {
-        newKey->info = NULL;
-        newKey->key = (char *)key2;
-        newKey->next = NULL;
+        keySpace2->ctrl[idx] = KS2_DELETED;
+        keySpace2->deleted++;
     }
-    return newKey;
+    keySpace2->used--;
+}
+
+// переносит из старой области до maxGroups групп, в конце переноса освобождает её
+void rehashStepKs2(Table *table, size_t maxGroups) {
+    KeySpace2 *oldKeySpace = table->ks2old;
+    if (!oldKeySpace) return;
+    size_t groups = oldKeySpace->msize / KS2_GROUP;
+    for (; maxGroups > 0 && table->rehashIdx < groups; maxGroups--, table->rehashIdx++) {
+        size_t first = table->rehashIdx * KS2_GROUP;
+        for (size_t i = first; i < first + KS2_GROUP; i++) {
+            if (!(oldKeySpace->ctrl[i] & 0x80)) continue; // пустая или удалённая
+            Item *item = oldKeySpace->info[i];
+            ks2Place(table->ks2, hashFunction(table, item->key2), item);
+            // надгробие, а не пустота: через ячейку могут идти пути других ключей
+            oldKeySpace->ctrl[i] = KS2_DELETED;
+            oldKeySpace->used--;
+        }
+    }
+    if (table->rehashIdx == groups) {
+        releaseKs2(oldKeySpace);
+        table->ks2old = NULL;
+        table->rehashIdx = 0;
+    }
+}
+
+/* индекс ячейки с key2 или INVALID_IDX;
+ * в where - область, где ключ найден (новая или ещё не перенесённая старая)
+ */
+size_t findKeyIdxKs2(Table *table, const char *key2, KeySpace2 **where) {
+    uint64_t hash = hashFunction(table, key2);
+    size_t idx = ks2Find(table->ks2, hash, key2);
+    *where = table->ks2;
+    if (idx == INVALID_IDX && table->ks2old) {
+        idx = ks2Find(table->ks2old, hash, key2);
+        *where = table->ks2old;
+    }
+    return idx;
+}
+
+// очистка ks2, не удаляет item и info
+void freeKs2 (Table *table) {
+    releaseKs2(table->ks2);
+    releaseKs2(table->ks2old);
+    table->ks2 = table->ks2old = NULL;
+}
+
+/* начинает перенос в область newCapacity ячеек (заодно выметая удалённые):
+ * новая область становится основной, старая разбирается по шагам.
+ * Незаконченный прошлый перенос сперва доводится до конца, так что
+ * областей никогда не больше двух. При ошибке выделения всё остаётся как было
+ */
+KeySpace2 *resizeKs2(Table *table, size_t newCapacity) {
+    newCapacity = ks2Capacity(newCapacity);
+    if (newCapacity < table->csize2 + table->csize2 / 8 + 1) {
+        logError("resizeKs2: new capacity is too small");
+        return NULL;
+    }
+    KeySpace2 *newKeySpace = allocKs2(newCapacity);
+    if (!newKeySpace) {
+        logError("memory reallocate error (resizeKs2)");
+        return NULL;
+    }
+    rehashStepKs2(table, SIZE_MAX);
+    table->ks2old = table->ks2;
+    table->rehashIdx = 0;
+    table->ks2 = newKeySpace;
+    table->msize2 = newCapacity;
+    return newKeySpace;
 }
 
 /* тут следим за оригинальностью key2 
  * решение в случае повтора: замена
- * ключи разные, один хэш? -> запись в конец цепочки через next 
  */
 int insertKs2(Table *table, const char *key2, Item *item) {
+    rehashStepKs2(table, KS2_REHASH_GROUPS);
 
-    // условие на увеличиение таблицы
-    if ((float)table->csize2 / (float)table->msize2 >= 0.75f) {
-        resizeKs2(table, table->msize2 * 2);
+    KeySpace2 *where;
+    size_t idx = findKeyIdxKs2(table, key2, &where);
+    if (idx != INVALID_IDX) { // если ключ совпал, заменяем информацию
+        where->info[idx] = item;
+        return 0;
     }
 
-    size_t idx = findKeyIdxKs2(table, key2);
-    KeySpace2 *found = table->ks2[idx]; // элемент (указатель) по индексу
-
-    if (!found) { // указатель на NULL (нет цепочки)
-        KeySpace2 *newKey = createNewKeyKs2(key2);
-        if (!newKey) {
-            logError("new key creation error");
+    // заполнение новой области вместе с удалёнными держим не выше 7/8
+    KeySpace2 *keySpace2 = table->ks2;
+    if ((keySpace2->used + keySpace2->deleted + 1) * 8 > keySpace2->msize * 7) {
+        // много удалённых - хватит перестроить в том же размере
+        size_t newCapacity = (table->csize2 + 1) * 2 > table->msize2 ? table->msize2 * 2 : table->msize2;
+        if (!resizeKs2(table, newCapacity)) {
             return -1;
         }
-        newKey->info = item;
-        table->ks2[idx] = newKey; // ставим указатель на первый элемент цепочки
-        table->csize2++; // новый ненулевой указатель в массиве
-        return 0;
-    } else { // указатель не на NULL (цепочка есть)
-        KeySpace2 *prevElem = found;
-        while (found) { // идём до последнего элемента
-            if (!strcmp(found->key, key2)) { // если ключ совпал, заменяем информацию
-                found->info = item;
-                return 0;
-            }
-            prevElem = found;
-            found = found->next;
-        } // не нашли такой ключ в цепочке, дошли до конца: prevElem->next = NULL, found = NULL
-        KeySpace2 *newKey = createNewKeyKs2(key2);
-        if (!newKey) {
-            logError("new key creation error");
-            return -1;
-        }
-        newKey->info = item;
-        prevElem->next = newKey;
-        return 0;
+        rehashStepKs2(table, KS2_REHASH_GROUPS);
     }
+
+    ks2Place(table->ks2, hashFunction(table, key2), item);
+    table->csize2++;
+    return 0;
 }
 
 /* здесь логика удаления указателя на ключ и соответствующего поля
  * логика удаления item и самого ключа будет в главной функции delete для table
  */
 int deleteKeyKs2(Table *table, const char *key2) {
+    rehashStepKs2(table, KS2_REHASH_GROUPS);
 
-    // условие на уменьшение таблицы
-    if (table->msize2 >= 32 && (float)table->csize2 / (float)table->msize2 <= 0.25f) {
-        resizeKs2(table, table->msize2 / 2);
+    KeySpace2 *where;
+    size_t idx = findKeyIdxKs2(table, key2, &where);
+    if (idx == INVALID_IDX) {
+        logError("the key is not found or does not exist");
+        return -1;
     }
+    ks2Remove(where, idx);
+    table->csize2--;
+    printf("Key '%s' deleted successfully\n", key2);
 
-    size_t idx = findKeyIdxKs2(table, key2);
-    KeySpace2 *findToDel = table->ks2[idx];
-    KeySpace2 *prevElem = findToDel; // для удаления из середины или конца должны знать предыдущий
-
-    while (findToDel) { // если цепочка существует
-        if (!strcmp(findToDel->key, key2)) { // ищем по уникальному ключу
-            if (findToDel == table->ks2[idx]) { // если элемент первый
-                table->ks2[idx] = findToDel->next; // перемещаем указатель на список на второй элемент
-                free(findToDel); // освобождаем память из-под первого
-                printf("Key '%s' deleted successfully\n", key2);
-                if (!table->ks2[idx]) { // если удалили единственный элемент цепочки
-                    table->csize2--;
-                }
-                return 0;
-            } else { // если элемент в середине или конце
-                prevElem->next = findToDel->next; // перешагиваем удаляемый элемент
-                free(findToDel); 
-                printf("Key '%s' deleted successfully\n", key2);
-                return 0;
-            }
-        }
-        prevElem = findToDel;
-        findToDel = findToDel->next;
-    } 
-    // если не вошли в цикл или вышли из него без удаления элемента
-    logError("the key is not found or does not exist");
-    return -1;
+    // условие на уменьшение таблицы (во время переноса не начинаем новый)
+    if (!table->ks2old && table->msize2 >= 32 && table->csize2 * 4 <= table->msize2) {
+        resizeKs2(table, table->msize2 / 2);
+    }
+    return 0;
 }
 
 
@@ -458,12 +884,11 @@ void printTable(const Table *);
 
 void freeTable(Table *table) {
     if (!table) return;
-    // удаляем всю информацию
-    for (size_t i = 0; table->csize1 != 0 ; i++) { // пока есть node'ы 
-        // выбивает ошибки, когда не находит индекс
-        // key1 - индекс внутри ks1
-        // NULL в key2 позволит удалять все релизы сразу
-        deleteItem(table, i, NULL); 
+    // удаляем всю информацию, каждый раз с наименьшего key1
+    // NULL в key2 позволит удалять все релизы сразу
+    KeySpace1 *first;
+    while ((first = firstKeyKs1(table)) != NULL) {
+        if (deleteItem(table, first->key, NULL) != 0) break;
     }
 
     // удаляем пространства таблиц
@@ -472,15 +897,19 @@ void freeTable(Table *table) {
     free(table);
 }
 
+// msize1 оставлен для совместимости: дерево ks1 растёт по узлу
 Table *initTable(size_t msize1, size_t msize2) {
+    (void)msize1;
     Table *newTable = (Table *)calloc(1, sizeof(Table));
     if (!newTable) {
         logError("table init error");
         return NULL;
     }
-    newTable->ks1 = initKs1(newTable, msize1);
+    // зерно из адреса таблицы и времени: у разных запусков разные коллизии
+    newTable->seed2 = wyMix((uint64_t)(uintptr_t)newTable ^ WY_P0, (uint64_t)time(NULL) ^ WY_P1);
+    KeySpace1 *keySpace1 = initKs1(newTable);
     newTable->ks2 = initKs2(newTable, msize2);
-    if (!newTable->ks1 || !newTable->ks2) {
+    if (!keySpace1 || !newTable->ks2) {
         freeTable(newTable);
         return NULL;
     }
@@ -491,32 +920,22 @@ Table *initTable(size_t msize1, size_t msize2) {
  * результатом поиска должна быть копии всех найденных элементов со значениями ключей;
 */
 Item *findItemByKey1(Table *table, size_t key1, size_t release) {
-    if (!table || !table->ks1 || table->csize1 == 0) {
+    if (!table || table->csize1 == 0) {
         return NULL;
     }
 
-    KeySpace1 *keySpace = table->ks1;
-    size_t start = 0, end = table->csize1 - 1;
-    while (start <= end) {
-        size_t middle = start + (end - start) / 2;
-        KeySpace1 currElem = keySpace[middle];
-        if (currElem.key == key1) { // если нашли ключ
-            Node1 *currNode = currElem.node;
-            while (currNode) { // бежим по списку пока не найдём нужную версию
-                if (currNode->release == release) {
-                    return currNode->info;
-                }
-                currNode = currNode->next;
+    KeySpace1 *currElem = findKeyKs1(table, key1);
+    if (currElem) { // если нашли ключ
+        Node1 *currNode = currElem->node;
+        while (currNode) { // бежим по списку пока не найдём нужную версию
+            if (currNode->release == release) {
+                return currNode->info;
             }
-            // если не нашли версию
-            logError("release not found for the given key1");
-            return NULL;
-        } else if (currElem.key > key1) {
-            if (middle == 0) break;
-            end = middle - 1;
-        } else {
-            start = middle + 1;
+            currNode = currNode->next;
         }
+        // если не нашли версию
+        logError("release not found for the given key1");
+        return NULL;
     }
     logError("key1 not found in ks1");
     return NULL; // если ключ не найден
@@ -524,15 +943,12 @@ Item *findItemByKey1(Table *table, size_t key1, size_t release) {
 
 // поиск указателя на элемент по второму ключу
 Item *findItemByKey2(Table *table, const char *key2) {
-    size_t idx = findKeyIdxKs2(table, key2);
-    KeySpace2 *found = table->ks2[idx];
-    while (found) { 
-        if (!strcmp(found->key, key2)) {
-            return found->info; // возвращаем указатель на item
-        }
-        found = found->next;
+    rehashStepKs2(table, KS2_REHASH_GROUPS);
+    KeySpace2 *where;
+    size_t idx = findKeyIdxKs2(table, key2, &where);
+    if (idx != INVALID_IDX) {
+        return where->info[idx]; // возвращаем указатель на item
     }
-    // цепочки по такому ключу нет
     logError("key2 not found in ks2");
     return NULL;
 }
@@ -548,15 +964,15 @@ int deleteItem(Table *table, size_t key1, const char *key2) {
             logError("item with this key2 was not found");
             return -1;
         }
-        size_t idx1 = (key1 != INVALID_KEY1) 
-            ? findKeyIdxKs1(table, key1)
-            : findKeyIdxKs1(table, itemToDelete->key1);
-        if (idx1 == INVALID_IDX) {
+        KeySpace1 *currElem = (key1 != INVALID_KEY1) 
+            ? findKeyKs1(table, key1)
+            : findKeyKs1(table, itemToDelete->key1);
+        if (!currElem) {
             logError("item with this key1 was not found");
             return -1;
         }
         // ищем запись по ключу с таким item'ом, чтобы удалить нужный релиз
-        Node1 *nodeToDelete = table->ks1[idx1].node;
+        Node1 *nodeToDelete = currElem->node;
         Node1 *prev = nodeToDelete;
         while (nodeToDelete) {
             if (nodeToDelete->info == itemToDelete) { // нашли node с указателем на нужный item
@@ -569,10 +985,9 @@ int deleteItem(Table *table, size_t key1, const char *key2) {
                 free(itemToDelete->key2); // удаляем сам ключ
                 free(itemToDelete); // удаляем item
                 if (nodeToDelete == prev) { // если первый Node
-                    KeySpace1 *currElem = &table->ks1[idx1];
                     currElem->node = nodeToDelete->next;
                     if (currElem->node == NULL) { // если первый и единственный 
-                        deleteKeyKs1(table, key1, 1);
+                        deleteKeyKs1(table, currElem->key, 1); // key1 может быть INVALID_KEY1
                     } 
                 } else { // если в середине или конце
                     prev->next = nodeToDelete->next;
@@ -586,12 +1001,11 @@ int deleteItem(Table *table, size_t key1, const char *key2) {
         logError("node doesn`t exist or item with corresponding release wasn`t found");
         return -1;
     } else if (key1 != INVALID_KEY1) { // удаление всех элементов, в составных ключах которых есть key1
-        size_t idxToDelete = findKeyIdxKs1(table, key1);
-        if (idxToDelete == INVALID_IDX) {
+        KeySpace1 *keyToDelete = findKeyKs1(table, key1);
+        if (!keyToDelete) {
             printf("Delete error, key '%u' not found\n", key1);
             return -1;
         }
-        KeySpace1 *keyToDelete = &table->ks1[idxToDelete];
         Node1 *nodeToDelete = keyToDelete->node;
 
         while (nodeToDelete) { // удаляем все версии
@@ -607,23 +1021,11 @@ int deleteItem(Table *table, size_t key1, const char *key2) {
                 logError("delete item procedure stoped, can`t delete key2 from table");
                 return -1;
             }
+            keyToDelete->node = next; // удалённые версии уже не в списке
             nodeToDelete = next;
         }
-        keyToDelete->key = INVALID_KEY1; //?? 
-        keyToDelete->node = NULL; // явно зануляем указатель после освобождения памяти 
-
-        for (size_t i = idxToDelete; i < table->csize1 - 1; i++) {
-            table->ks1[i] = table->ks1[i + 1];
-        }
-        table->csize1--;
+        removeKeyKs1(table, key1); // узлы дерева освобождаются сами при слиянии
         printf("All items with key '%u' successfully deleted\n", key1);
-        // можно уменьшать ks1 по необходимости (minsize1 = 16)
-        if (table->csize1 < table->msize1 / 2 && table->msize1 >= 32) {
-            KeySpace1 *KeySpace = resizeKs1(table, table->msize1 / 2);
-            if (!KeySpace) {
-                logError("resize error (after item delete)");
-            }
-        }
         return 0;
     } else {
         logError("there is no keys");
@@ -705,9 +1107,9 @@ Item **findItem(Table *table, size_t key1, const char *key2) {
         return result;
     } else if (key1 != INVALID_KEY1) { // поиск только по первому
         // можно добавить поиск отдельного релиза
-        size_t idx = findKeyIdxKs1(table, key1);
-        if (idx == INVALID_IDX) return NULL;
-        Node1 *node = table->ks1[idx].node;
+        KeySpace1 *found = findKeyKs1(table, key1);
+        if (!found) return NULL;
+        Node1 *node = found->node;
         size_t releaseNum = 0; // считаем число релизов
         while (node) {
             releaseNum++;
@@ -718,7 +1120,7 @@ Item **findItem(Table *table, size_t key1, const char *key2) {
             return NULL;
         }
         Item **result = (Item **)malloc((releaseNum + 1) * sizeof(Item *));
-        node = table->ks1[idx].node;
+        node = found->node;
         for (size_t i = 0; i < releaseNum; i++) {
             result[i] = node->info;
             node = node->next;
@@ -743,13 +1145,15 @@ void printTable(const Table* table) {
     // Статистика
     size_t total_items = 0;
     size_t max_releases = 0;
-    for (size_t i = 0; i < table->csize1; i++) {
-        size_t count = 0;
-        for (Node1 *node = table->ks1[i].node; node; node = node->next) {
-            count++;
+    for (const Leaf1 *leaf = table->ks1.first; leaf; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; i++) {
+            size_t count = 0;
+            for (Node1 *node = leaf->entries[i].node; node; node = node->next) {
+                count++;
+            }
+            total_items += count;
+            if (count > max_releases) max_releases = count;
         }
-        total_items += count;
-        if (count > max_releases) max_releases = count;
     }
 
     // Шапка
@@ -758,8 +1162,10 @@ void printTable(const Table* table) {
     printf("+-----------+----------------+---------+---------------------------+\n");
 
     // Данные
-    for (size_t i = 0; i < table->csize1; i++) {
-        KeySpace1 *ks1 = &table->ks1[i];
+    // листья связаны по возрастанию ключа
+    for (const Leaf1 *leaf = table->ks1.first; leaf; leaf = leaf->next)
+    for (int i = 0; i < leaf->count; i++) {
+        const KeySpace1 *ks1 = &leaf->entries[i];
         Node1 *node = ks1->node;
         while (node) {
             Item *item = node->info;
@@ -775,7 +1181,7 @@ void printTable(const Table* table) {
             }
             node = node->next;
         }
-        if (i < table->csize1 - 1) {
+        if (i < leaf->count - 1 || leaf->next) {
             printf("+-----------+----------------+---------+---------------------------+\n");
         }
     }